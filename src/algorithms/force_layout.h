@@ -0,0 +1,448 @@
+/*
+Force-directed layout: edges are springs pulling their endpoints together and every pair of nodes repels
+(Fruchterman-Reingold forces, with ideal edge length k). Repulsion is approximated with a Barnes-Hut quadtree, so an
+iteration costs O(E + N log N) rather than O(N^2), and forces are accumulated in parallel over slices of the nodes.
+
+layout::relax runs iterations synchronously on a graph's position columns. layout::start runs them on a background
+thread instead and publishes positions through a triple buffer; whoever owns the position columns copies the newest
+ones in with layout::sync, so the layout converges while the dynamics run. A layout with more than one thread keeps
+its helpers in a thread pool for as long as it lives, so iterations do not pay for starting threads.
+*/
+#ifndef FORCE_LAYOUT_H
+#define FORCE_LAYOUT_H
+
+
+#include <math.h>
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../types.h"
+#include "../thread_pool.h"
+#include "../data_structures/graph.h"
+#include "../data_structures/builder.h"  // graph::default_num_threads
+#include "../data_structures/triple_buffer.h"
+
+// Barnes-Hut opening angle: a cell is used as a single mass when its side is below theta times its distance.
+#define LAYOUT_THETA (0.8f)
+// Cells stop splitting at this depth, so coincident nodes share a leaf instead of recursing forever.
+#define LAYOUT_MAX_DEPTH 24
+// Below this many nodes per thread, spawning helpers costs more than it saves.
+#define LAYOUT_MIN_NODES_PER_THREAD 2048
+// Temperature (largest move per iteration, in units of k): starting value, decay per iteration, and floor.
+#define LAYOUT_START_TEMPERATURE (1.f)
+#define LAYOUT_COOLING (0.98f)
+#define LAYOUT_MIN_TEMPERATURE (0.01f)
+// A background layout whose largest move falls below this (in units of k) sleeps until disturbed.
+#define LAYOUT_CONVERGED (0.002f)
+// Upper bound on how often a background layout publishes positions.
+#define LAYOUT_PUBLISH_HZ (120.)
+
+namespace layout {
+    //// Types
+    typedef struct cell Cell;
+    typedef struct positions Positions;
+    typedef struct layout Layout;
+
+    //// forward declarations
+    // structs
+    struct cell;
+    struct positions;
+    struct layout;
+
+    // functions
+    Layout* make(const graph::Graph*, float, uint);
+    void destroy(Layout*);
+    float iterate(Layout*);
+    void relax(graph::Graph*, uint, float, uint);
+    void start(Layout*);
+    void stop(Layout*);
+    bool sync(Layout*, graph::Properties*);
+    void hold(Layout*, uint, float, float);
+    void release(Layout*);
+
+
+    //// Implementations
+    // Quadtree cell. Interior cells have four children starting at `child`; leaves hold `count` nodes, the first
+    // of which is `body` (more than one only at LAYOUT_MAX_DEPTH).
+    struct cell {
+        float ox, oy, half;  // center and half side length
+        float mx, my;        // center of mass (sums of positions until the tree is finalized)
+        uint count;          // number of nodes inside
+        int child;           // first of four children, or -1 for a leaf
+        uint body;
+    };
+
+    struct positions {
+        std::vector<float> x, y;
+        uint64_t iteration;
+    };
+
+    struct layout {
+        uint num_nodes;
+        // symmetric adjacency, so springs pull on both ends of directed edges
+        std::vector<uint> offsets, neighbors;
+
+        std::vector<float> x, y;    // current positions
+        std::vector<float> dx, dy;  // displacement accumulated this iteration
+        std::vector<Cell> cells;
+        std::vector<float> largest; // per-thread largest move of the last iteration
+
+        float k;
+        float temperature;
+        uint num_threads;
+        thread_pool::Pool* helpers;  // num_threads - 1 of them, or nullptr when single-threaded
+        uint64_t iterations;
+
+        // background thread
+        std::thread thread;
+        std::atomic<bool> running;
+        std::atomic<bool> quit;
+        // node pinned by the user (or graph::NIL) and where, always set and read together under hold_lock
+        std::mutex hold_lock;
+        uint held;
+        float held_x, held_y;
+        triple_buffer::TripleBuffer<Positions> published;
+    };
+
+    // Set up a layout of `graph` starting from its current positions, with ideal edge length `k`.
+    // The topology is copied, so the graph may change afterwards; the layout keeps the one it was made with.
+    Layout*
+    make(const graph::Graph* graph, float k = 1.f, uint num_threads = graph::default_num_threads()) {
+        Layout* layout = new Layout;
+        assert(layout);
+        uint n = (uint) graph->nodes.size();
+        layout->num_nodes = n;
+
+        std::vector<uint> degree(n + 1, 0);
+        for (const auto& edge : graph->edges) {
+            ++degree[edge.first];
+            if (! graph->is_undirected) ++degree[edge.second];
+        }
+        layout->offsets.assign(n + 1, 0);
+        for (uint v = 0; v < n; ++v) layout->offsets[v + 1] = layout->offsets[v] + degree[v];
+        layout->neighbors.resize(layout->offsets[n]);
+        std::copy(layout->offsets.begin(), layout->offsets.end() - 1, degree.begin());
+        for (const auto& edge : graph->edges) {
+            layout->neighbors[degree[edge.first]++] = edge.second;
+            if (! graph->is_undirected) layout->neighbors[degree[edge.second]++] = edge.first;
+        }
+
+        layout->x = graph->properties.x;
+        layout->y = graph->properties.y;
+        layout->dx.resize(n);
+        layout->dy.resize(n);
+        layout->k = k;
+        layout->temperature = LAYOUT_START_TEMPERATURE * k;
+        num_threads = std::min(num_threads, n / LAYOUT_MIN_NODES_PER_THREAD);
+        layout->num_threads = std::max(1u, num_threads);
+        layout->largest.resize(layout->num_threads);
+        layout->helpers = (layout->num_threads > 1) ? thread_pool::make(layout->num_threads - 1) : nullptr;
+        layout->iterations = 0;
+
+        layout->running.store(false);
+        layout->quit.store(false);
+        layout->held = graph::NIL;
+        layout->held_x = layout->held_y = 0.f;
+        triple_buffer::init(&layout->published);
+        return layout;
+    }
+
+    void
+    destroy(Layout* layout) {
+        if (layout->running.load()) stop(layout);
+        if (layout->helpers != nullptr) thread_pool::destroy(layout->helpers);
+        delete layout;
+    }
+
+    // Add node `body` at (x, y) to the tree, splitting the leaf it lands in if that is occupied.
+    static void
+    insert(Layout* layout, uint body, float x, float y) {
+        std::vector<Cell>& cells = layout->cells;
+        uint current = 0;
+        for (int depth = 0; ; ++depth) {
+            Cell* c = &cells[current];
+            if (c->child < 0) {
+                if (c->count == 0 || depth == LAYOUT_MAX_DEPTH) {
+                    if (c->count == 0) c->body = body;
+                    c->count++;
+                    c->mx += x;
+                    c->my += y;
+                    return;
+                }
+                // split: the resident moves into one of four new children
+                int first = (int) cells.size();
+                float h = 0.5f * c->half, ox = c->ox, oy = c->oy;
+                uint resident = c->body;
+                for (int q = 0; q < 4; ++q) {
+                    cells.push_back(Cell{ ox + ((q & 1) ? h : -h), oy + ((q & 2) ? h : -h), h, 0.f, 0.f, 0, -1, 0 });
+                }
+                c = &cells[current];
+                c->child = first;
+                float rx = layout->x[resident], ry = layout->y[resident];
+                Cell* r = &cells[first + (rx >= ox ? 1 : 0) + (ry >= oy ? 2 : 0)];
+                r->body = resident;
+                r->count = 1;
+                r->mx = rx;
+                r->my = ry;
+            }
+            c->count++;
+            c->mx += x;
+            c->my += y;
+            current = c->child + (x >= c->ox ? 1 : 0) + (y >= c->oy ? 2 : 0);
+        }
+    }
+
+    // Rebuild the quadtree over the current positions.
+    static void
+    build_tree(Layout* layout) {
+        const std::vector<float>& x = layout->x;
+        const std::vector<float>& y = layout->y;
+        float x0 = x[0], x1 = x[0], y0 = y[0], y1 = y[0];
+        for (uint v = 1; v < layout->num_nodes; ++v) {
+            x0 = std::min(x0, x[v]); x1 = std::max(x1, x[v]);
+            y0 = std::min(y0, y[v]); y1 = std::max(y1, y[v]);
+        }
+        float half = 0.5f * std::max(x1 - x0, y1 - y0) * 1.0001f + 1e-6f;
+
+        layout->cells.clear();
+        layout->cells.push_back(Cell{ 0.5f * (x0 + x1), 0.5f * (y0 + y1), half, 0.f, 0.f, 0, -1, 0 });
+        for (uint v = 0; v < layout->num_nodes; ++v) {
+            insert(layout, v, x[v], y[v]);
+        }
+        for (Cell& c : layout->cells) {
+            if (c.count == 0) continue;
+            c.mx /= (float) c.count;
+            c.my /= (float) c.count;
+        }
+    }
+
+    // Accumulate spring and repulsion displacements for nodes [begin, end). Positions are only read, so slices can run
+    // in parallel; see apply_moves.
+    static void
+    accumulate_forces(Layout* layout, uint begin, uint end) {
+        const std::vector<Cell>& cells = layout->cells;
+        const float* x = layout->x.data();
+        const float* y = layout->y.data();
+        float k = layout->k, k2 = k * k;
+        float theta2 = LAYOUT_THETA * LAYOUT_THETA;
+        int stack[4 * LAYOUT_MAX_DEPTH + 4];
+
+        for (uint v = begin; v < end; ++v) {
+            float fx = 0.f, fy = 0.f;
+            float vx = x[v], vy = y[v];
+
+            // repulsion, k^2 / d per node, from the tree
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                const Cell& c = cells[stack[--top]];
+                if (c.count == 0) continue;
+                float ddx = vx - c.mx, ddy = vy - c.my;
+                float d2 = ddx * ddx + ddy * ddy;
+                if (c.child < 0 || 4.f * c.half * c.half < theta2 * d2) {
+                    if (c.child < 0 && c.body == v && c.count == 1) continue;
+                    if (d2 < 1e-12f) {
+                        // coincident: push apart in a direction fixed by the node index
+                        ddx = (v & 1) ? 1e-3f * k : -1e-3f * k;
+                        ddy = (v & 2) ? 1e-3f * k : -1e-3f * k;
+                        d2 = ddx * ddx + ddy * ddy;
+                    }
+                    float s = k2 * (float) c.count / d2;
+                    fx += ddx * s;
+                    fy += ddy * s;
+                } else {
+                    for (int q = 0; q < 4; ++q) stack[top++] = c.child + q;
+                }
+            }
+
+            // springs, d^2 / k along each edge
+            for (uint i = layout->offsets[v]; i < layout->offsets[v + 1]; ++i) {
+                uint u = layout->neighbors[i];
+                float ddx = vx - x[u], ddy = vy - y[u];
+                float d = sqrtf(ddx * ddx + ddy * ddy);
+                fx -= ddx * d / k;
+                fy -= ddy * d / k;
+            }
+            layout->dx[v] = fx;
+            layout->dy[v] = fy;
+        }
+    }
+
+    // Apply the displacements of nodes [begin, end), capped at the temperature. Returns the largest move.
+    static float
+    apply_moves(Layout* layout, uint begin, uint end) {
+        float t = layout->temperature, largest = 0.f;
+        for (uint v = begin; v < end; ++v) {
+            float fx = layout->dx[v], fy = layout->dy[v];
+            float f = sqrtf(fx * fx + fy * fy);
+            if (f <= 0.f) continue;
+            float step = std::min(f, t);
+            layout->x[v] += fx / f * step;
+            layout->y[v] += fy / f * step;
+            largest = std::max(largest, step);
+        }
+        return largest;
+    }
+
+    // Run f(t, begin, end) for every thread t of the layout, on slice [begin, end) of the nodes. The calling thread
+    // takes slice 0 and the helpers the rest.
+    template <typename F>
+    static void
+    run_slices(Layout* layout, F f) {
+        uint n = layout->num_nodes, num_threads = layout->num_threads;
+        auto slice = [n, num_threads, &f](uint t) {
+            f(t, (uint) ((uint64_t) n * t / num_threads), (uint) ((uint64_t) n * (t + 1) / num_threads));
+        };
+        for (uint t = 1; t < num_threads; ++t) {
+            thread_pool::submit(layout->helpers, [&slice, t] { slice(t); });
+        }
+        slice(0);
+        if (num_threads > 1) thread_pool::wait(layout->helpers);
+    }
+
+    // One layout iteration: rebuild the tree, accumulate forces in parallel, then move every node at once.
+    // Returns the largest distance any node moved.
+    float
+    iterate(Layout* layout) {
+        uint n = layout->num_nodes;
+        if (n < 2) return 0.f;
+        build_tree(layout);
+
+        run_slices(layout, [layout](uint, uint begin, uint end) {
+            accumulate_forces(layout, begin, end);
+        });
+        run_slices(layout, [layout](uint t, uint begin, uint end) {
+            layout->largest[t] = apply_moves(layout, begin, end);
+        });
+
+        // a node held by the user stays where it was put
+        {
+            std::lock_guard<std::mutex> guard(layout->hold_lock);
+            if (layout->held < n) {
+                layout->x[layout->held] = layout->held_x;
+                layout->y[layout->held] = layout->held_y;
+            }
+        }
+
+        layout->temperature = std::max(layout->temperature * LAYOUT_COOLING, LAYOUT_MIN_TEMPERATURE * layout->k);
+        layout->iterations++;
+        return *std::max_element(layout->largest.begin(), layout->largest.end());
+    }
+
+    // Run `iterations` layout iterations on the graph's current positions, in place.
+    void
+    relax(graph::Graph* graph, uint iterations, float k = 1.f, uint num_threads = graph::default_num_threads()) {
+        Layout* layout = make(graph, k, num_threads);
+        for (uint i = 0; i < iterations; ++i) {
+            iterate(layout);
+        }
+        graph->properties.x = layout->x;
+        graph->properties.y = layout->y;
+        destroy(layout);
+    }
+
+    static void
+    publish(Layout* layout) {
+        Positions* positions = triple_buffer::writable(&layout->published);
+        positions->x = layout->x;
+        positions->y = layout->y;
+        positions->iteration = layout->iterations;
+        triple_buffer::publish(&layout->published);
+    }
+
+    static void
+    run(Layout* layout) {
+        typedef std::chrono::steady_clock clock;
+        auto last_publish = clock::now();
+        uint last_held = graph::NIL;
+        bool dirty = false;
+
+        while (! layout->quit.load(std::memory_order_acquire)) {
+            // dragging a node disturbs the layout: warm it back up
+            uint held;
+            {
+                std::lock_guard<std::mutex> guard(layout->hold_lock);
+                held = layout->held;
+            }
+            if (held != graph::NIL || last_held != graph::NIL) {
+                layout->temperature = std::max(layout->temperature, 0.1f * layout->k);
+            }
+            last_held = held;
+
+            bool converged = layout->temperature <= LAYOUT_MIN_TEMPERATURE * layout->k
+                && *std::max_element(layout->largest.begin(), layout->largest.end()) < LAYOUT_CONVERGED * layout->k;
+            if (converged && held == graph::NIL) {
+                if (dirty) {
+                    publish(layout);
+                    dirty = false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+
+            iterate(layout);
+            dirty = true;
+            auto now = clock::now();
+            if (std::chrono::duration<double>(now - last_publish).count() >= 1. / LAYOUT_PUBLISH_HZ) {
+                publish(layout);
+                dirty = false;
+                last_publish = now;
+            }
+        }
+        if (dirty) publish(layout);
+    }
+
+    // Start iterating on a background thread. Positions are only published; see sync.
+    void
+    start(Layout* layout) {
+        assert( ! layout->running.load() );
+        std::fill(layout->largest.begin(), layout->largest.end(), INFINITY);
+        layout->quit.store(false);
+        layout->running.store(true);
+        layout->thread = std::thread(run, layout);
+    }
+
+    void
+    stop(Layout* layout) {
+        layout->quit.store(true, std::memory_order_release);
+        layout->thread.join();
+        layout->running.store(false);
+    }
+
+    // Copy the newest published positions into `properties`, if there are any not copied yet. Returns true if so.
+    // Only one thread may call this.
+    bool
+    sync(Layout* layout, graph::Properties* properties) {
+        if (! triple_buffer::acquire(&layout->published)) return false;
+        const Positions* positions = triple_buffer::readable(&layout->published);
+        std::copy(positions->x.begin(), positions->x.end(), properties->x.begin());
+        std::copy(positions->y.begin(), positions->y.end(), properties->y.begin());
+        return true;
+    }
+
+    // Pin a node at (x, y), e.g. while the user drags it; the rest of the layout relaxes around it. Safe to call while
+    // the layout runs in the background: the node and its position are taken together.
+    void
+    hold(Layout* layout, uint node, float x, float y) {
+        std::lock_guard<std::mutex> guard(layout->hold_lock);
+        layout->held = node;
+        layout->held_x = x;
+        layout->held_y = y;
+    }
+
+    void
+    release(Layout* layout) {
+        std::lock_guard<std::mutex> guard(layout->hold_lock);
+        layout->held = graph::NIL;
+    }
+
+} // end namespace
+
+
+#endif
@@ -6,6 +6,7 @@
 
 #include "../types.h"
 #include "../data_structures/graph.h"
+#include "../data_structures/csr.h"
 
 namespace graph {
 
@@ -14,6 +15,10 @@ namespace graph {
     accumulate_nodes(const Graph* graph, uint node, void* ordering) {
         ((std::vector<uint>*) ordering)->push_back(node);
     }
+    void 
+    accumulate_nodes(const CSR* graph, uint node, void* ordering) {
+        ((std::vector<uint>*) ordering)->push_back(node);
+    }
 
     // Get a BFS linearization of a graph.
     // Allows an optional custom function to apply to nodes over the course of the traversal.
@@ -71,4 +76,58 @@ namespace graph {
         }
     } // end dfs
 
+    // Same as above, for a frozen graph. Neighbors are visited in ascending order.
+    void
+    bfs(
+        const CSR* graph, uint source, 
+        void (*f) (const CSR* graph, uint node, void* data) = nullptr,
+        void* data = nullptr
+    ) {
+        std::vector<bool> visited(graph->num_nodes, false);
+        std::queue<uint> queue;
+        queue.push(source);
+
+        while (! queue.empty()) {
+            auto node = queue.front();
+            queue.pop();
+            for (uint i = graph->offsets[node]; i < graph->offsets[node + 1]; ++i) {
+                auto next = graph->neighbors[i];
+                if (! visited[next]) {
+                    visited[next] = true;
+                    queue.push(next);
+
+                    // apply custom function to node
+                    if (f != nullptr) f(graph, next, data);
+                }
+            }
+        }
+    } // end bfs
+
+    // Same as above, for a frozen graph.
+    void
+    dfs(
+        const CSR* graph, uint source, 
+        void (*f) (const CSR* graph, uint node, void* data) = nullptr,
+        void* data = nullptr
+    ) {
+        std::vector<bool> visited(graph->num_nodes, false);
+        std::vector<uint> stack;
+        stack.push_back(source);
+
+        while (! stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            for (uint i = graph->offsets[node]; i < graph->offsets[node + 1]; ++i) {
+                auto next = graph->neighbors[i];
+                if (! visited[next]) {
+                    visited[next] = true;
+                    stack.push_back(next);
+
+                    // apply custom function to node
+                    if (f != nullptr) f(graph, next, data);
+                }
+            }
+        }
+    } // end dfs
+
 } // end namespace
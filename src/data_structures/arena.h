@@ -0,0 +1,161 @@
+/*
+A simple arena allocator: bump allocation out of large blocks, plus power-of-two size-class pools for memory that
+is handed back before the arena dies (e.g. adjacency lists that outgrow their slot).
+Nothing is returned to the system until the whole arena is destroyed, which is a handful of frees.
+
+Not thread-safe.
+*/
+#ifndef ARENA_H
+#define ARENA_H
+
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <assert.h>
+#include <vector>
+
+#include "../types.h"
+
+// Default size of a bump block.
+#define ARENA_BLOCK_SIZE (1 << 20)
+// All allocations are rounded up to (and aligned on) this many bytes.
+#define ARENA_ALIGNMENT (16)
+// Size classes are powers of two from 2^4 = ARENA_ALIGNMENT bytes up to 2^63 bytes.
+#define ARENA_MIN_CLASS (4)
+#define ARENA_NUM_CLASSES (64)
+
+namespace arena {
+    //// Types
+    typedef struct arena Arena;
+
+    //// forward declarations
+    // structs
+    struct arena;
+
+    // functions
+    Arena* make(size_t);
+    void destroy(Arena*);
+    void* alloc(Arena*, size_t);
+    void* alloc_pooled(Arena*, size_t);
+    inline size_t pooled_size(size_t);
+    void release(Arena*, void*, size_t);
+
+
+    //// Implementations
+    struct arena {
+        size_t block_size;
+        std::vector<void*> blocks;  // every block ever malloc'd, freed on destroy
+
+        // current bump block
+        char* cursor;
+        size_t remaining;
+
+        // intrusive singly-linked free lists, one per power-of-two size class
+        void* free_lists[ARENA_NUM_CLASSES];
+    };
+
+    static inline size_t
+    round_up(size_t bytes) {
+        return (bytes + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+    }
+
+    // Smallest class whose size is >= bytes.
+    static inline uint
+    class_ceil(size_t bytes) {
+        uint c = ARENA_MIN_CLASS;
+        while (((size_t) 1 << c) < bytes) ++c;
+        return c;
+    }
+
+    // Largest class whose size is <= bytes.
+    static inline uint
+    class_floor(size_t bytes) {
+        uint c = ARENA_MIN_CLASS;
+        while (((size_t) 1 << (c + 1)) <= bytes) ++c;
+        return c;
+    }
+
+    // Create an empty arena. No memory is reserved until the first allocation.
+    Arena*
+    make(size_t block_size = ARENA_BLOCK_SIZE) {
+        Arena* arena = new Arena;
+        assert(arena);
+
+        arena->block_size = block_size;
+        arena->cursor = nullptr;
+        arena->remaining = 0;
+        for (uint c = 0; c < ARENA_NUM_CLASSES; ++c) {
+            arena->free_lists[c] = nullptr;
+        }
+        return arena;
+    }
+
+    // Free every block owned by the arena. All pointers handed out by it become invalid.
+    void
+    destroy(Arena* arena) {
+        for (void* block : arena->blocks) {
+            free(block);
+        }
+        delete arena;
+    }
+
+    // Bump-allocate `bytes` bytes. Requests larger than half a block get a dedicated block so that
+    // a big up-front allocation (e.g. all nodes of a graph) does not waste the tail of the current block.
+    void*
+    alloc(Arena* arena, size_t bytes) {
+        bytes = round_up(bytes);
+
+        if (bytes > arena->block_size / 2) {
+            void* block = malloc(bytes);
+            assert(block);
+            arena->blocks.push_back(block);
+            return block;
+        }
+
+        if (bytes > arena->remaining) {
+            arena->cursor = (char*) malloc(arena->block_size);
+            assert(arena->cursor);
+            arena->blocks.push_back(arena->cursor);
+            arena->remaining = arena->block_size;
+        }
+
+        void* ptr = arena->cursor;
+        arena->cursor += bytes;
+        arena->remaining -= bytes;
+        return ptr;
+    }
+
+    // Allocate at least `bytes` bytes from the matching size-class pool, falling back to the bump region.
+    void*
+    alloc_pooled(Arena* arena, size_t bytes) {
+        uint c = class_ceil(bytes);
+        void* ptr = arena->free_lists[c];
+        if (ptr != nullptr) {
+            arena->free_lists[c] = *((void**) ptr);
+            return ptr;
+        }
+        return alloc(arena, (size_t) 1 << c);
+    }
+
+    // Size of the chunk alloc_pooled hands out for a request of `bytes` bytes. Releasing it with this size files it
+    // back under the class it came from; callers can use the slack past `bytes` instead of wasting it.
+    inline size_t
+    pooled_size(size_t bytes) {
+        return (size_t) 1 << class_ceil(bytes);
+    }
+
+    // Hand `bytes` bytes at `ptr` (allocated from this arena) back to the pools for reuse.
+    // The chunk is filed under the largest class it can fully serve.
+    void
+    release(Arena* arena, void* ptr, size_t bytes) {
+        if (ptr == nullptr || bytes < ((size_t) 1 << ARENA_MIN_CLASS)) return;
+
+        uint c = class_floor(bytes);
+        *((void**) ptr) = arena->free_lists[c];
+        arena->free_lists[c] = ptr;
+    }
+
+} // end namespace
+
+
+#endif
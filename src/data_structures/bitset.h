@@ -0,0 +1,128 @@
+/*
+A packed, dynamically sized bitset stored as 64-bit words.
+Used for per-node boolean columns (e.g. opinions) so that whole-graph queries run as word-wide popcounts.
+
+Bits past `size` in the last word are always kept zero, so counts can be taken over whole words.
+*/
+#ifndef BITSET_H
+#define BITSET_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace bitset {
+    //// Types
+    typedef struct bitset Bitset;
+
+    //// forward declarations
+    // structs
+    struct bitset;
+
+    // functions
+    inline uint popcount(uint64_t);
+    inline uint ctz(uint64_t);
+    inline size_t num_words(size_t);
+    void resize(Bitset*, size_t);
+    bool get(const Bitset*, size_t);
+    void set(Bitset*, size_t, bool);
+    void fill(Bitset*, bool);
+    size_t count(const Bitset*);
+    uint64_t tail_mask(const Bitset*);
+
+
+    //// Implementations
+    struct bitset {
+        size_t size;  // number of bits
+        std::vector<uint64_t> words;
+    };
+
+    inline uint
+    popcount(uint64_t word) {
+    #ifdef _MSC_VER
+        return (uint) __popcnt64(word);
+    #else
+        return (uint) __builtin_popcountll(word);
+    #endif
+    }
+
+    // Index of the lowest set bit of a nonzero word.
+    inline uint
+    ctz(uint64_t word) {
+        assert( word != 0 );
+    #ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return (uint) index;
+    #else
+        return (uint) __builtin_ctzll(word);
+    #endif
+    }
+
+    // Number of words needed to hold `num_bits` bits.
+    inline size_t
+    num_words(size_t num_bits) {
+        return (num_bits + 63) / 64;
+    }
+
+    // Mask of the valid bits in the last word (all ones if the size is a multiple of 64).
+    uint64_t
+    tail_mask(const Bitset* bits) {
+        uint rem = (uint) (bits->size % 64);
+        return (rem == 0) ? ~(uint64_t) 0 : (((uint64_t) 1 << rem) - 1);
+    }
+
+    // Resize to `size` bits. New bits are zero.
+    void
+    resize(Bitset* bits, size_t size) {
+        bits->words.resize(num_words(size), 0);
+        bits->size = size;
+        if (! bits->words.empty()) {
+            bits->words.back() &= tail_mask(bits);
+        }
+    }
+
+    bool
+    get(const Bitset* bits, size_t i) {
+        assert( i < bits->size );
+        return (bits->words[i / 64] >> (i % 64)) & 1;
+    }
+
+    void
+    set(Bitset* bits, size_t i, bool value) {
+        assert( i < bits->size );
+        uint64_t mask = (uint64_t) 1 << (i % 64);
+        uint64_t& word = bits->words[i / 64];
+        word = (word & ~mask) | (((uint64_t) 0 - (uint64_t) value) & mask);
+    }
+
+    // Set every bit to `value`.
+    void
+    fill(Bitset* bits, bool value) {
+        std::fill(bits->words.begin(), bits->words.end(), value ? ~(uint64_t) 0 : 0);
+        if (! bits->words.empty()) {
+            bits->words.back() &= tail_mask(bits);
+        }
+    }
+
+    // Number of set bits.
+    size_t
+    count(const Bitset* bits) {
+        size_t total = 0;
+        for (uint64_t word : bits->words) {
+            total += popcount(word);
+        }
+        return total;
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,252 @@
+/*
+Bulk construction of graph::Graph from a whole edge list.
+
+Instead of hashing every edge through add_edge, the builder counts degrees, buckets edges by source (a counting sort),
+sorts and dedups each adjacency run, and then allocates every node exactly once at its final size.
+Per-node work is split across threads. The edge -> position index is left to be built lazily on first use.
+
+The lower-level make_with_capacity / list_edges pair is also used by generators that know their degrees up front and
+write adjacency lists directly.
+*/
+#ifndef BUILDER_H
+#define BUILDER_H
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "../types.h"
+#include "graph.h"
+#include "csr.h"
+#include "arena.h"
+
+// Below this many edges the builder stays on the calling thread.
+#define BUILDER_PARALLEL_THRESHOLD (1 << 16)
+
+namespace graph {
+
+    //// forward declarations
+    // functions
+    Graph* make_with_capacity(const std::vector<uint>&, bool, allocation);
+    void list_edges(Graph*, uint);
+    uint default_num_threads();
+    Graph* build(uint, const edge_t*, size_t, bool, allocation, uint);
+    Graph* build(uint, const std::vector<edge_t>&, bool, allocation, uint);
+    Graph* thaw(const CSR*, allocation, uint);
+
+
+    //// Implementations
+    uint
+    default_num_threads() {
+        uint n = std::thread::hardware_concurrency();
+        return (n == 0) ? 1 : n;
+    }
+
+    // Run f(begin, end) over contiguous node ranges on `num_threads` threads, balancing the ranges by the amount of
+    // adjacency data they cover. `offsets` has num_nodes + 1 entries, as in a CSR layout.
+    template <typename F>
+    void
+    parallel_for_nodes(const std::vector<uint>& offsets, uint num_threads, F f) {
+        uint num_nodes = (uint) offsets.size() - 1;
+        uint num_edges = offsets.back();
+        if (num_threads <= 1 || num_edges < BUILDER_PARALLEL_THRESHOLD) {
+            f(0u, num_nodes);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        uint begin = 0;
+        for (uint t = 0; t < num_threads && begin < num_nodes; ++t) {
+            // first node whose run starts past this thread's share of the edges
+            uint target = (uint) (((unsigned long long) num_edges * (t + 1)) / num_threads);
+            uint end = (t + 1 == num_threads) ? num_nodes
+                : (uint) (std::upper_bound(offsets.begin() + begin, offsets.end() - 1, target) - offsets.begin());
+            end = std::max(end, begin + 1);
+            threads.emplace_back(f, begin, end);
+            begin = end;
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Create a graph with one node per entry of `capacity`, node n having room for capacity[n] adjacent nodes and no
+    // edges. With ALLOC_ARENA, all nodes are carved out of a single region sized for their final capacity.
+    // Callers that fill adjacency lists directly must call list_edges afterwards.
+    Graph*
+    make_with_capacity(const std::vector<uint>& capacity, bool undirected = false, allocation alloc = ALLOC_MALLOC) {
+        Graph* graph = new Graph;
+        assert(graph);
+
+        uint num_nodes = (uint) capacity.size();
+        graph->is_undirected = undirected;
+        graph->arena = (alloc == ALLOC_ARENA) ? arena::make() : nullptr;
+        graph->nodes.resize(num_nodes);
+        graph->properties.x.assign(num_nodes, 0.f);
+        graph->properties.y.assign(num_nodes, 0.f);
+        bitset::resize(&graph->properties.opinion, num_nodes);
+
+        // nodes are carved at 8-byte boundaries so that they can later be handed back to the arena's pools
+        auto carved_size = [](uint num_slots) { return (node_size(num_slots) + 7) & ~(size_t) 7; };
+
+        char* region = nullptr;
+        if (graph->arena != nullptr) {
+            size_t total = 0;
+            for (uint n = 0; n < num_nodes; ++n) {
+                total += carved_size(std::max(capacity[n], 1u));
+            }
+            if (total > 0) {
+                region = (char*) arena::alloc(graph->arena, total);
+            }
+        }
+
+        for (uint n = 0; n < num_nodes; ++n) {
+            uint num_slots = std::max(capacity[n], 1u);
+            Node* node;
+            if (region != nullptr) {
+                node = (Node*) region;
+                region += carved_size(num_slots);
+            } else {
+                node = (Node*) malloc(node_size(num_slots));
+            }
+            assert(node);
+            node->num_adjacent = 0;
+            node->num_slots = num_slots;
+            node->is_sorted = 1;
+            graph->nodes[n] = node;
+        }
+
+        return graph;
+    }
+
+    // Rebuild the edge list from the adjacency lists, in order of source then adjacency position.
+    // The edge -> position index is reset and rebuilt lazily on first use.
+    void
+    list_edges(Graph* graph, uint num_threads = default_num_threads()) {
+        uint num_nodes = (uint) graph->nodes.size();
+        std::vector<uint> offsets(num_nodes + 1, 0);
+        for (uint n = 0; n < num_nodes; ++n) {
+            offsets[n + 1] = offsets[n] + graph->nodes[n]->num_adjacent;
+        }
+
+        graph->edges.resize(offsets[num_nodes]);
+        parallel_for_nodes(offsets, num_threads, [&](uint first, uint last) {
+            for (uint n = first; n < last; ++n) {
+                const Node* node = graph->nodes[n];
+                for (uint i = 0; i < node->num_adjacent; ++i) {
+                    graph->edges[ offsets[n] + i ] = std::make_pair(n, node->adjacent[i]);
+                }
+            }
+        });
+        graph->edge_index.clear();
+    }
+
+    // Build a graph with `num_nodes` nodes from the edges in [begin, end), which dereference to graph::edge_t.
+    // Duplicate edges are dropped. If `undirected`, every edge is added in both directions.
+    // Adjacency lists come out sorted, and the edge list is ordered by source then dest.
+    template <typename Iterator>
+    Graph*
+    build(
+        uint num_nodes, Iterator begin, Iterator end,
+        bool undirected = false, allocation alloc = ALLOC_MALLOC, uint num_threads = default_num_threads()
+    ) {
+        // degree pre-pass
+        std::vector<uint> offsets(num_nodes + 1, 0);
+        for (Iterator it = begin; it != end; ++it) {
+            const edge_t& edge = *it;
+            assert( edge.first < num_nodes && edge.second < num_nodes );
+            offsets[edge.first + 1]++;
+            if (undirected && edge.first != edge.second) offsets[edge.second + 1]++;
+        }
+        for (uint n = 0; n < num_nodes; ++n) {
+            offsets[n + 1] += offsets[n];
+        }
+
+        // bucket neighbors by source
+        std::vector<uint> neighbors(offsets[num_nodes]);
+        {
+            std::vector<uint> cursor(offsets.begin(), offsets.end() - 1);
+            for (Iterator it = begin; it != end; ++it) {
+                const edge_t& edge = *it;
+                neighbors[ cursor[edge.first]++ ] = edge.second;
+                if (undirected && edge.first != edge.second) neighbors[ cursor[edge.second]++ ] = edge.first;
+            }
+        }
+
+        // sort and dedup each run
+        std::vector<uint> degrees(num_nodes);
+        parallel_for_nodes(offsets, num_threads, [&](uint first, uint last) {
+            for (uint n = first; n < last; ++n) {
+                auto run_begin = neighbors.begin() + offsets[n];
+                auto run_end = neighbors.begin() + offsets[n + 1];
+                std::sort(run_begin, run_end);
+                degrees[n] = (uint) (std::unique(run_begin, run_end) - run_begin);
+            }
+        });
+
+        // allocate every node once at its final size, then fill
+        Graph* graph = make_with_capacity(degrees, undirected, alloc);
+        parallel_for_nodes(offsets, num_threads, [&](uint first, uint last) {
+            for (uint n = first; n < last; ++n) {
+                Node* node = graph->nodes[n];
+                memcpy(node->adjacent, neighbors.data() + offsets[n], sizeof(uint) * degrees[n]);
+                node->num_adjacent = degrees[n];
+            }
+        });
+        neighbors.clear();
+        neighbors.shrink_to_fit();
+
+        list_edges(graph, num_threads);
+        return graph;
+    }
+
+    // Same as above, for a contiguous array of `num_edges` edges.
+    Graph*
+    build(
+        uint num_nodes, const edge_t* edges, size_t num_edges,
+        bool undirected = false, allocation alloc = ALLOC_MALLOC, uint num_threads = default_num_threads()
+    ) {
+        return build(num_nodes, edges, edges + num_edges, undirected, alloc, num_threads);
+    }
+
+    // Same as above, for a vector of edges.
+    Graph*
+    build(
+        uint num_nodes, const std::vector<edge_t>& edges,
+        bool undirected = false, allocation alloc = ALLOC_MALLOC, uint num_threads = default_num_threads()
+    ) {
+        return build(num_nodes, edges.begin(), edges.end(), undirected, alloc, num_threads);
+    }
+
+    // Build a mutable graph with the same topology and properties as a frozen one (the inverse of freeze).
+    Graph*
+    thaw(const CSR* csr, allocation alloc = ALLOC_MALLOC, uint num_threads = default_num_threads()) {
+        std::vector<uint> offsets(csr->offsets, csr->offsets + csr->num_nodes + 1);
+        std::vector<uint> degrees(csr->num_nodes);
+        for (uint n = 0; n < csr->num_nodes; ++n) {
+            degrees[n] = offsets[n + 1] - offsets[n];
+        }
+
+        Graph* graph = make_with_capacity(degrees, csr->is_undirected, alloc);
+        parallel_for_nodes(offsets, num_threads, [&](uint first, uint last) {
+            for (uint n = first; n < last; ++n) {
+                Node* node = graph->nodes[n];
+                memcpy(node->adjacent, csr->neighbors + offsets[n], sizeof(uint) * degrees[n]);
+                node->num_adjacent = degrees[n];
+            }
+        });
+        graph->properties = csr->properties;
+
+        list_edges(graph, num_threads);
+        return graph;
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,180 @@
+/*
+A compressed sparse row (CSR) representation of a directed graph whose topology is frozen.
+All adjacency lists live back to back in one `neighbors` array, indexed by `offsets`, and node properties live in
+contiguous columns, so neighbor walks are cache-linear and there is no per-node heap allocation.
+
+Build one from an existing graph::Graph with graph::freeze once the topology is fixed, or open a saved one with
+io::load_csr (io/binary.h), in which case the topology arrays point straight into a read-only file mapping.
+*/
+#ifndef CSR_H
+#define CSR_H
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#include "../types.h"
+#include "graph.h"
+
+namespace graph {
+    //// Types
+    typedef struct csr CSR;
+
+    //// forward declarations
+    // structs
+    struct csr;
+
+    // functions
+    CSR* freeze(const Graph*);
+    CSR* share(const CSR*);
+    void destroy(CSR*);
+    bool has_node(const CSR*, uint);
+    int degree(const CSR*, uint);
+    int has_edge(const CSR*, uint, uint);
+    void foreach(CSR* graph, uint source, void (*f) (CSR* graph, uint source, uint dest, void* data), void* data);
+    bool opinion(const CSR*, uint);
+    void set_opinion(CSR*, uint, bool);
+
+
+    //// Implementations
+    // Frozen graph. The neighbors of node n are neighbors[ offsets[n] ] ... neighbors[ offsets[n+1] - 1 ], sorted.
+    // The topology arrays are read-only and do not own their memory: they point either into offsets_storage /
+    // neighbors_storage (freeze) or into memory released through release_backing (e.g. a file mapping).
+    // NOTE: offsets are 32-bit, so a CSR graph holds at most 2^32 - 1 edges.
+    struct csr {
+        uint num_nodes;
+        uint num_edges;
+        bool is_undirected;  // every edge is stored in both directions
+
+        const uint* offsets;  // num_nodes + 1 entries
+        const uint* neighbors;  // num_edges entries
+
+        // owned topology, empty when the arrays live elsewhere
+        std::vector<uint> offsets_storage;
+        std::vector<uint> neighbors_storage;
+
+        // external owner of the topology arrays, released on destroy
+        void* backing;
+        void (*release_backing)(void*);
+
+        Properties properties;
+    };
+
+    // Build a CSR graph from the current state of `graph` in one pass over its adjacency lists.
+    // Later changes to `graph` are not reflected in the result.
+    CSR*
+    freeze(const Graph* graph) {
+        CSR* csr = new CSR;
+        assert(csr);
+
+        csr->num_nodes = (uint) graph->nodes.size();
+        csr->num_edges = (uint) graph->edges.size();
+        csr->is_undirected = graph->is_undirected;
+        csr->offsets_storage.resize(csr->num_nodes + 1);
+        csr->neighbors_storage.resize(csr->num_edges);
+        csr->backing = nullptr;
+        csr->release_backing = nullptr;
+        csr->properties = graph->properties;
+
+        uint offset = 0;
+        auto& neighbors = csr->neighbors_storage;
+        for (uint n = 0; n < csr->num_nodes; ++n) {
+            const Node* node = graph->nodes[n];
+            csr->offsets_storage[n] = offset;
+            std::copy(node->adjacent, node->adjacent + node->num_adjacent, neighbors.begin() + offset);
+            // sorted runs make has_edge a binary search and give a deterministic traversal order
+            std::sort(neighbors.begin() + offset, neighbors.begin() + offset + node->num_adjacent);
+            offset += node->num_adjacent;
+        }
+        csr->offsets_storage[csr->num_nodes] = offset;
+        assert( offset == csr->num_edges );
+
+        csr->offsets = csr->offsets_storage.data();
+        csr->neighbors = csr->neighbors_storage.data();
+        return csr;
+    }
+
+    // A CSR graph that borrows the topology of `graph` and has properties of its own: opinions sized to the graph
+    // (all false) and nothing else. Many can share one topology, e.g. one per replica of an ensemble, and `graph`
+    // must outlive them all.
+    CSR*
+    share(const CSR* graph) {
+        CSR* csr = new CSR;
+        assert(csr);
+
+        csr->num_nodes = graph->num_nodes;
+        csr->num_edges = graph->num_edges;
+        csr->is_undirected = graph->is_undirected;
+        csr->offsets = graph->offsets;
+        csr->neighbors = graph->neighbors;
+        csr->backing = nullptr;
+        csr->release_backing = nullptr;
+        bitset::resize(&csr->properties.opinion, graph->num_nodes);
+        return csr;
+    }
+
+    // Free a CSR graph created by freeze, share or io::load_csr.
+    void
+    destroy(CSR* graph) {
+        if (graph->release_backing != nullptr) {
+            graph->release_backing(graph->backing);
+        }
+        delete graph;
+    }
+
+    bool
+    has_node(const CSR* graph, uint node) {
+        return (node < graph->num_nodes);
+    }
+
+    // Get count of adjacent nodes to a query node that exists in the graph.
+    int
+    degree(const CSR* graph, uint node) {
+        assert( has_node(graph, node) == 1 );
+        return graph->offsets[node + 1] - graph->offsets[node];
+    }
+
+    // Return 1 if edge (source, dest) exists, 0 otherwise.
+    // O(log degree(source)) since adjacency runs are sorted.
+    int
+    has_edge(const CSR* graph, uint source, uint dest) {
+        assert( has_node(graph, source) == 1 );
+        assert( has_node(graph, dest) == 1 );
+
+        const uint* begin = graph->neighbors + graph->offsets[source];
+        const uint* end = graph->neighbors + graph->offsets[source + 1];
+        return std::binary_search(begin, end, dest);
+    }
+
+    // Get the opinion of a node that exists in the graph.
+    bool
+    opinion(const CSR* graph, uint node) {
+        return bitset::get(&graph->properties.opinion, node);
+    }
+
+    // Set the opinion of a node that exists in the graph.
+    void
+    set_opinion(CSR* graph, uint node, bool value) {
+        bitset::set(&graph->properties.opinion, node, value);
+    }
+
+    // Invoke a function `f` over all edges (source, dest) with `data` supplied as the final parameter to `f`.
+    // Edges are visited in ascending order of dest.
+    void
+    foreach(
+        CSR* graph, uint source,
+        void (*f) (CSR* graph, uint source, uint dest, void* data),
+        void* data
+    ) {
+        assert( has_node(graph, source) );
+        for (uint i = graph->offsets[source]; i < graph->offsets[source + 1]; ++i) {
+            f(graph, source, graph->neighbors[i], data);
+        }
+    }
+
+} // end namespace
+
+
+#endif
@@ -9,12 +9,15 @@ TODO: graph is almost certainly not memory-efficient. Try to allocate contiguous
 
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
-#include <unordered_set>
+#include <unordered_map>
 #include <tuple>
 #include <vector>
 
 #include "../types.h"
+#include "bitset.h"
+#include "arena.h"
 
 namespace graph {
     //// Types
@@ -22,7 +25,15 @@ namespace graph {
     typedef struct node Node;
     typedef struct properties Properties;
     typedef std::pair<uint, uint> edge_t;
-    typedef std::pair<Node*, Node*> edge_ptr_t;
+
+    // How node structs (and their adjacency lists) are allocated.
+    enum allocation {
+        ALLOC_MALLOC,  // one malloc per node, realloc on growth
+        ALLOC_ARENA,   // nodes bump-allocated from one region, growth served by size-class pools
+    };
+
+    // Sentinel node index, e.g. for an edge sampled from a graph with no edges.
+    const uint NIL = (uint) -1;
 
     //// forward declarations
     // structs
@@ -31,27 +42,32 @@ namespace graph {
     struct graph;
 
     // functions
-    Graph* make(uint, bool);
+    Graph* make(uint, bool, allocation);
     void destroy(Graph*);
     bool has_node(const Graph*, uint);
     int degree(const Graph*, uint);
     static int intcmp(const void*, const void*);
     int has_edge(const Graph*, uint, uint);
     void add_edge(Graph*, uint, uint);
+    void remove_edge(Graph*, uint, uint);
+    void index_edges(Graph*);
     void foreach(Graph* graph, uint source, void (*f) (Graph* graph, uint source, uint dest, void* data), void* data);
+    bool opinion(const Graph*, uint);
+    void set_opinion(Graph*, uint, bool);
 
 
     //// Implementations
+    // Per-node properties stored as columns indexed by node (structure of arrays).
     struct properties {
-        float x, y;
-        bool opinion;
+        std::vector<float> x, y;  // spatial location
+        bitset::Bitset opinion;  // one bit per node
+        std::vector<uint> block;  // community membership; empty unless the graph has planted communities
     };
 
     // Graph node with adjacency list.
     struct node {
         uint num_adjacent;
         uint num_slots;  // number of array slots
-        Properties* properties;
         bool is_sorted;  // true if list is sorted
                          // NOTE: all types except char require alignment since char is 1 byte (cf. http://www.catb.org/esr/structure-packing/)
         uint adjacent[1];  // adjacency list 
@@ -67,36 +83,83 @@ namespace graph {
         bool is_undirected;
 
         std::vector<Node*> nodes;
-        std::unordered_set<edge_t, edge_hash> edges;
+
+        // Dense edge list so that edges can be addressed (and sampled) by index in O(1).
+        // `edge_index` maps each edge to its position in `edges`; removal swaps the last edge into the hole.
+        // The index is only needed for edge updates and fast edge queries, so bulk construction leaves it empty and
+        // the first update builds it (see index_edges). Readers never build it, so a graph that is not being modified
+        // can be read from several threads at once.
+        // NOTE: there is no guaranteed ordering to the edges.
+        std::vector<edge_t> edges;
+        std::unordered_map<edge_t, uint, edge_hash> edge_index;
+
+        Properties properties;
+
+        arena::Arena* arena;  // nullptr unless allocated with ALLOC_ARENA
     };
 
+    // Size in bytes of a node struct with room for `num_slots` adjacent nodes.
+    static inline size_t
+    node_size(uint num_slots) {
+        return sizeof(Node) + sizeof(uint) * (num_slots - 1);
+    }
+
+    // Reallocate a node so that it has room for at least `num_slots` adjacent nodes, using the graph's allocation
+    // strategy. Returns the (possibly moved) node.
+    static Node*
+    resize_node(Graph* graph, Node* node, uint num_slots) {
+        if (graph->arena == nullptr) {
+            node = (Node*) realloc(node, node_size(num_slots));
+            assert(node);
+        } else {
+            // take the whole pooled chunk, so that node_size(num_slots) is its exact size when it is released again
+            size_t chunk = arena::pooled_size(node_size(num_slots));
+            num_slots = (uint) ((chunk - sizeof(Node)) / sizeof(uint)) + 1;
+            Node* grown = (Node*) arena::alloc_pooled(graph->arena, chunk);
+            memcpy(grown, node, node_size(node->num_slots));
+            arena::release(graph->arena, node, node_size(node->num_slots));
+            node = grown;
+        }
+        node->num_slots = num_slots;
+        return node;
+    }
+
     // Create a graph with num_nodes vertices, no edges.
-    // Graph is heap-allocated via malloc.
+    // Graph is heap-allocated via malloc. With ALLOC_ARENA, all nodes are carved out of one region of an arena owned
+    // by the graph, and adjacency lists that outgrow their slots are moved into size-class pools instead of realloc'd.
     Graph* 
-    make(uint num_nodes, bool undirected = false) {
+    make(uint num_nodes, bool undirected = false, allocation alloc = ALLOC_MALLOC) {
         Graph* graph = new Graph;
         assert(graph);
 
+        graph->arena = (alloc == ALLOC_ARENA) ? arena::make() : nullptr;
+        char* region = nullptr;
+        if (graph->arena != nullptr && num_nodes > 0) {
+            region = (char*) arena::alloc(graph->arena, (size_t) num_nodes * node_size(1));
+        }
+
         graph->nodes.reserve(num_nodes);
 
+        // initialize all spatial locations as 0.f and all opinions as false
+        // TODO: allow uninitialized?
+        graph->properties.x.assign(num_nodes, 0.f);
+        graph->properties.y.assign(num_nodes, 0.f);
+        bitset::resize(&graph->properties.opinion, num_nodes);
+
         for (uint i = 0; i < num_nodes; ++i) {
-            graph->nodes.push_back( (Node*) malloc(sizeof(Node)) );
+            if (region != nullptr) {
+                graph->nodes.push_back( (Node*) (region + (size_t) i * node_size(1)) );
+            } else {
+                graph->nodes.push_back( (Node*) malloc(sizeof(Node)) );
+            }
             assert(graph->nodes[i]);
 
-            // initialize all spatial locations as 0.f
-            // TODO: allow uninitialized?
-            graph->nodes[i]->properties = (Properties*) malloc(sizeof(Properties));
-            assert(graph->nodes[i]->properties);
-            graph->nodes[i]->properties->x 
-                = graph->nodes[i]->properties->y 
-                = 0.f;
-
             graph->nodes[i]->num_adjacent = 0;
             graph->nodes[i]->num_slots = 1;  
             graph->nodes[i]->is_sorted = 1;  // we initialize the adjacency lists in sorted order trivially
         }
 
-        // graph->is_undirected = (char) undirected;
+        graph->is_undirected = undirected;
 
         return graph;
     }
@@ -104,10 +167,13 @@ namespace graph {
     // Free the heap-allocated memory for a graph struct.
     void 
     destroy(Graph* graph) {
+        if (graph->arena != nullptr) {
+            arena::destroy(graph->arena);
+            delete graph;
+            return;
+        }
         for (uint i = 0; i < graph->nodes.size(); ++i) {
-            // delete graph->nodes[i]->properties;
             // delete graph->nodes[i];
-            free(graph->nodes[i]->properties);
             free(graph->nodes[i]);
         }
         // free(graph);
@@ -134,16 +200,21 @@ namespace graph {
     }
 
     // Return 1 if edge (source, dest) exists, 0 otherwise.
-    // O(n log n) on first call due to possible sorting, but subsequent calls without the addition of edges will be faster.
+    // O(1) through the edge index once it is built (see index_edges), otherwise a scan of the source's adjacency list.
+    // Never writes to the graph.
     int 
     has_edge(const Graph* graph, uint source, uint dest) {
         assert( has_node(graph, source) == 1 );
         assert( has_node(graph, dest) == 1 );
 
-        if (graph->edges.empty()) return 0;
-
-        bool ret = ( graph->edges.find(std::make_pair(source, dest)) != graph->edges.end() );
-        return ret;
+        if (graph->edge_index.size() == graph->edges.size()) {
+            return graph->edge_index.find(std::make_pair(source, dest)) != graph->edge_index.end();
+        }
+        const Node* node = graph->nodes[source];
+        for (uint i = 0; i < node->num_adjacent; ++i) {
+            if (node->adjacent[i] == dest) return 1;
+        }
+        return 0;
 
         // // If the node has a relatively high degree, do a faster typically O(log n) search.
         // // In this case, it's probably worth taking the rare O(n log n) sorting hit to be faster later.
@@ -174,6 +245,20 @@ namespace graph {
         // }
     }
 
+    // Build the edge -> position index if it is out of date with the edge list, i.e. after bulk construction.
+    // Edge updates do this themselves; call it directly to make has_edge O(1) on a graph that is about to be queried
+    // a lot. O(E).
+    void
+    index_edges(Graph* graph) {
+        if (graph->edge_index.size() == graph->edges.size()) return;
+
+        graph->edge_index.clear();
+        graph->edge_index.reserve(graph->edges.size());
+        for (uint i = 0; i < graph->edges.size(); ++i) {
+            graph->edge_index.emplace(graph->edges[i], i);
+        }
+    }
+
     // Add an edge to an existing graph.
     void 
     add_edge(Graph* graph, uint u, uint v) {
@@ -181,15 +266,14 @@ namespace graph {
         assert( has_node(graph, v) == 1 );
 
         // early out if edge already exists
+        index_edges(graph);
         if (has_edge(graph, u, v)) {
             return;
         }
 
         // grow the adjacency list by powers of 2 if we have too many edges
-        while (graph->nodes[u]->num_adjacent >= graph->nodes[u]->num_slots) {
-            graph->nodes[u]->num_slots *= 2;
-            graph->nodes[u] = (Node*) realloc(graph->nodes[u], 
-                sizeof(Node) + sizeof(int) * (graph->nodes[u]->num_slots - 1));
+        if (graph->nodes[u]->num_adjacent >= graph->nodes[u]->num_slots) {
+            graph->nodes[u] = resize_node(graph, graph->nodes[u], 2 * graph->nodes[u]->num_slots);
         }
 
         // add the new edge
@@ -206,8 +290,55 @@ namespace graph {
         //     graph->num_edges--;  // need to decrement b/c of symmetry
         // }
 
-        // update edge set
-        graph->edges.insert(std::make_pair(u, v));
+        // update edge list
+        graph->edge_index.emplace(std::make_pair(u, v), (uint) graph->edges.size());
+        graph->edges.push_back(std::make_pair(u, v));
+    }
+
+    // Remove an edge from an existing graph. Does nothing if the edge does not exist.
+    // O(degree(u)) for the adjacency list, O(1) for the edge list.
+    void
+    remove_edge(Graph* graph, uint u, uint v) {
+        assert( has_node(graph, u) == 1 );
+        assert( has_node(graph, v) == 1 );
+
+        index_edges(graph);
+        auto it = graph->edge_index.find(std::make_pair(u, v));
+        if (it == graph->edge_index.end()) {
+            return;
+        }
+
+        // swap-and-pop out of the edge list, fixing up the index of the edge that moved into the hole
+        uint idx = it->second;
+        graph->edge_index.erase(it);
+        if (idx != graph->edges.size() - 1) {
+            graph->edges[idx] = graph->edges.back();
+            graph->edge_index[ graph->edges[idx] ] = idx;
+        }
+        graph->edges.pop_back();
+
+        // swap-and-pop out of the adjacency list
+        Node* node = graph->nodes[u];
+        for (uint i = 0; i < node->num_adjacent; ++i) {
+            if (node->adjacent[i] == v) {
+                node->adjacent[i] = node->adjacent[ node->num_adjacent - 1 ];
+                node->num_adjacent--;
+                node->is_sorted = 0;
+                break;
+            }
+        }
+    }
+
+    // Get the opinion of a node that exists in the graph.
+    bool
+    opinion(const Graph* graph, uint node) {
+        return bitset::get(&graph->properties.opinion, node);
+    }
+
+    // Set the opinion of a node that exists in the graph.
+    void
+    set_opinion(Graph* graph, uint node, bool value) {
+        bitset::set(&graph->properties.opinion, node, value);
     }
 
     // Invoke a function `f` over all edges (source, dest) with `data` supplied as the final parameter to `f`.
@@ -0,0 +1,140 @@
+/*
+A fixed-capacity ring buffer, safe for one producer thread and one consumer thread (or a single thread doing both).
+
+The producer never blocks: when the ring is full, the new item is dropped and the ring goes into an overflowed state in
+which every further item is dropped too, until the consumer calls reset. A consumer that has missed items this way
+resynchronizes from full state. To line full state up with the item stream, the producer can record `position` (items
+ever pushed) and `epoch` (number of resets seen) next to it: state tagged with the current epoch and position p already
+reflects every item before p, and the consumer skips those with drain_from.
+Head and tail are free-running 64-bit counters, so full and empty are told apart without a spare slot.
+*/
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include <atomic>
+#include <vector>
+
+#include "../types.h"
+
+namespace ring_buffer {
+    //// Types
+    template <typename T> struct ring_buffer;
+    template <typename T> using RingBuffer = ring_buffer<T>;
+
+
+    //// Implementations
+    template <typename T>
+    struct ring_buffer {
+        std::vector<T> slots;  // power-of-two count
+        uint64_t mask;
+
+        // producer and consumer counters live on separate cache lines
+        alignas(64) std::atomic<uint64_t> head;  // items ever pushed
+        alignas(64) std::atomic<uint64_t> tail;  // items ever popped
+        std::atomic<bool> overflowed;  // items are being dropped until the next reset
+        std::atomic<uint64_t> epoch;  // number of resets
+    };
+
+    // Size an empty ring to hold at least `capacity` items.
+    template <typename T>
+    void
+    init(RingBuffer<T>* ring, size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        ring->slots.assign(size, T());
+        ring->mask = size - 1;
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->tail.store(0, std::memory_order_relaxed);
+        ring->overflowed.store(false, std::memory_order_relaxed);
+        ring->epoch.store(0, std::memory_order_relaxed);
+    }
+
+    // Number of items waiting to be popped.
+    template <typename T>
+    size_t
+    size(const RingBuffer<T>* ring) {
+        return (size_t) (ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_acquire));
+    }
+
+    // Producer: append an item. If the ring is full or overflowed, drop it and return false.
+    template <typename T>
+    bool
+    push(RingBuffer<T>* ring, const T& item) {
+        if (ring->overflowed.load(std::memory_order_acquire)) return false;
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) > ring->mask) {
+            ring->overflowed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        ring->slots[head & ring->mask] = item;
+        ring->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: remove the oldest item into `item`. Returns false if the ring is empty.
+    template <typename T>
+    bool
+    pop(RingBuffer<T>* ring, T* item) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        if (tail == ring->head.load(std::memory_order_acquire)) return false;
+        *item = ring->slots[tail & ring->mask];
+        ring->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: number of items ever pushed, i.e. the position the next item will have.
+    template <typename T>
+    uint64_t
+    position(const RingBuffer<T>* ring) {
+        return ring->head.load(std::memory_order_relaxed);
+    }
+
+    // Consumer: call f(item) on every item present now whose position is at least `from`, oldest first, then remove
+    // every item present now. Returns the number of items passed to f.
+    template <typename T, typename F>
+    size_t
+    drain_from(RingBuffer<T>* ring, uint64_t from, F f) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t first = (from > tail) ? (from < head ? from : head) : tail;
+        for (uint64_t i = first; i != head; ++i) {
+            f(ring->slots[i & ring->mask]);
+        }
+        ring->tail.store(head, std::memory_order_release);
+        return (size_t) (head - first);
+    }
+
+    // Consumer: call f(item) on every item present now, oldest first, then remove them. Returns the count.
+    template <typename T, typename F>
+    size_t
+    drain(RingBuffer<T>* ring, F f) {
+        return drain_from(ring, 0, f);
+    }
+
+    // Consumer: whether items have been dropped since the last reset.
+    template <typename T>
+    bool
+    overflowed(const RingBuffer<T>* ring) {
+        return ring->overflowed.load(std::memory_order_acquire);
+    }
+
+    // Consumer: discard every queued item, leave the overflowed state and start a new epoch, which is returned.
+    // Full state tagged with this epoch reflects everything dropped before the reset.
+    template <typename T>
+    uint64_t
+    reset(RingBuffer<T>* ring) {
+        // the producer pushes nothing while overflowed, so head is stable here
+        ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+        ring->overflowed.store(false, std::memory_order_release);
+        // bumped after the flag is cleared: a producer that sees the new epoch also sees the flag cleared
+        return ring->epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,137 @@
+/*
+A uniform grid over node positions, for finding the nodes near a point or inside a rectangle without visiting every
+node. Nodes are bucketed by cell with a counting sort into one array (`offsets` per cell, as in a CSR layout), so a
+rebuild is two linear passes and a query only visits the cells it overlaps.
+
+The grid is a snapshot: after nodes move it must be rebuilt before it is queried again.
+*/
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+
+#include <math.h>
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#include "../types.h"
+#include "graph.h"  // graph::NIL
+
+// Largest number of cells per node; keeps sparse or very spread-out layouts from allocating huge empty grids.
+#define SPATIAL_GRID_CELLS_PER_NODE 2
+
+namespace spatial_grid {
+    //// Types
+    typedef struct grid Grid;
+
+    //// forward declarations
+    // structs
+    struct grid;
+
+    // functions
+    void build(Grid*, const std::vector<float>&, const std::vector<float>&, float);
+    template <typename F> void query(const Grid*, float, float, float, float, F);
+    uint nearest(const Grid*, const std::vector<float>&, const std::vector<float>&, float, float, float);
+
+
+    //// Implementations
+    struct grid {
+        float x0, y0;     // lower corner
+        float cell;       // cell side length
+        uint nx, ny;      // cells per row and per column
+        std::vector<uint> offsets;  // nx * ny + 1 entries; nodes of cell c are nodes[offsets[c], offsets[c + 1])
+        std::vector<uint> nodes;
+    };
+
+    static inline uint
+    cell_x(const Grid* grid, float x) {
+        float cx = floorf((x - grid->x0) / grid->cell);
+        return (cx <= 0.f) ? 0 : std::min((uint) cx, grid->nx - 1);
+    }
+
+    static inline uint
+    cell_y(const Grid* grid, float y) {
+        float cy = floorf((y - grid->y0) / grid->cell);
+        return (cy <= 0.f) ? 0 : std::min((uint) cy, grid->ny - 1);
+    }
+
+    // Bucket every node by position. Cells are at least `min_cell` wide (e.g. the largest query radius), and otherwise
+    // sized for about one node per cell.
+    void
+    build(Grid* grid, const std::vector<float>& x, const std::vector<float>& y, float min_cell) {
+        uint n = (uint) x.size();
+        float x0 = 0.f, x1 = 0.f, y0 = 0.f, y1 = 0.f;
+        if (n > 0) {
+            x0 = x1 = x[0];
+            y0 = y1 = y[0];
+        }
+        for (uint v = 1; v < n; ++v) {
+            x0 = std::min(x0, x[v]); x1 = std::max(x1, x[v]);
+            y0 = std::min(y0, y[v]); y1 = std::max(y1, y[v]);
+        }
+        float width = x1 - x0, height = y1 - y0;
+        float cell = std::max(min_cell, sqrtf(width * height / (float) std::max(n, 1u)));
+        // nodes on a line (or all in one place) have no area to divide up
+        if (! (cell > 0.f)) cell = std::max(std::max(width, height) / (float) std::max(n, 1u), 1e-6f);
+        // cap the cell count for layouts that are mostly empty space
+        double max_cells = (double) SPATIAL_GRID_CELLS_PER_NODE * std::max(n, 1u);
+        while ((double) (width / cell + 1.f) * (double) (height / cell + 1.f) > max_cells) cell *= 2.f;
+
+        grid->x0 = x0;
+        grid->y0 = y0;
+        grid->cell = cell;
+        grid->nx = (uint) (width / cell) + 1;
+        grid->ny = (uint) (height / cell) + 1;
+
+        // counting sort by cell
+        std::vector<uint>& offsets = grid->offsets;
+        offsets.assign((size_t) grid->nx * grid->ny + 1, 0);
+        for (uint v = 0; v < n; ++v) {
+            offsets[cell_y(grid, y[v]) * grid->nx + cell_x(grid, x[v]) + 1]++;
+        }
+        for (size_t c = 1; c < offsets.size(); ++c) offsets[c] += offsets[c - 1];
+        grid->nodes.resize(n);
+        std::vector<uint> next(offsets.begin(), offsets.end() - 1);
+        for (uint v = 0; v < n; ++v) {
+            grid->nodes[next[cell_y(grid, y[v]) * grid->nx + cell_x(grid, x[v])]++] = v;
+        }
+    }
+
+    // Call f(node) for every node in a cell overlapping the rectangle [qx0, qx1] x [qy0, qy1]. This is a superset of
+    // the nodes inside it: callers that need exactness test positions themselves.
+    template <typename F>
+    void
+    query(const Grid* grid, float qx0, float qy0, float qx1, float qy1, F f) {
+        if (grid->nodes.empty()) return;
+        uint cx0 = cell_x(grid, qx0), cx1 = cell_x(grid, qx1);
+        uint cy0 = cell_y(grid, qy0), cy1 = cell_y(grid, qy1);
+        for (uint cy = cy0; cy <= cy1; ++cy) {
+            const uint* first = &grid->offsets[(size_t) cy * grid->nx];
+            for (uint i = first[cx0]; i < first[cx1 + 1]; ++i) {
+                f(grid->nodes[i]);
+            }
+        }
+    }
+
+    // The node nearest to (px, py) within `radius`, or graph::NIL if there is none.
+    uint
+    nearest(const Grid* grid, const std::vector<float>& x, const std::vector<float>& y, float px, float py,
+            float radius) {
+        uint best = graph::NIL;
+        float best_d2 = radius * radius;
+        query(grid, px - radius, py - radius, px + radius, py + radius, [&](uint v) {
+            float dx = x[v] - px, dy = y[v] - py;
+            float d2 = dx * dx + dy * dy;
+            if (d2 <= best_d2) {
+                best_d2 = d2;
+                best = v;
+            }
+        });
+        return best;
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,106 @@
+/*
+A sum tree: non-negative weights on leaves 0..n-1, with every internal node holding the sum of its children, stored
+implicitly as a complete binary tree in one array (root at 1, children of i at 2i and 2i + 1, leaves from
+`capacity`). Setting a weight and sampling a leaf in proportion to its weight both take O(log n).
+
+Internal sums are recomputed from the children on every update rather than adjusted by the difference, so rounding
+errors do not build up over long runs.
+*/
+#ifndef SUM_TREE_H
+#define SUM_TREE_H
+
+
+#include <stddef.h>
+#include <assert.h>
+#include <vector>
+
+namespace sum_tree {
+    //// Types
+    typedef struct sum_tree SumTree;
+
+    //// forward declarations
+    // structs
+    struct sum_tree;
+
+    // functions
+    void init(SumTree*, size_t);
+    void assign(SumTree*, const std::vector<double>&);
+    inline double get(const SumTree*, size_t);
+    void set(SumTree*, size_t, double);
+    inline double total(const SumTree*);
+    size_t sample(const SumTree*, double);
+
+
+    //// Implementations
+    struct sum_tree {
+        size_t size;      // number of leaves in use
+        size_t capacity;  // size rounded up to a power of two
+        std::vector<double> nodes;  // 2 * capacity entries; nodes[0] is unused
+    };
+
+    // Make room for `size` leaves, all with weight 0.
+    void
+    init(SumTree* tree, size_t size) {
+        tree->size = size;
+        tree->capacity = 1;
+        while (tree->capacity < size) tree->capacity *= 2;
+        tree->nodes.assign(2 * tree->capacity, 0.);
+    }
+
+    // Set every weight at once in O(n).
+    void
+    assign(SumTree* tree, const std::vector<double>& weights) {
+        init(tree, weights.size());
+        for (size_t i = 0; i < weights.size(); ++i) {
+            assert( weights[i] >= 0. );
+            tree->nodes[tree->capacity + i] = weights[i];
+        }
+        for (size_t i = tree->capacity - 1; i > 0; --i) {
+            tree->nodes[i] = tree->nodes[2 * i] + tree->nodes[2 * i + 1];
+        }
+    }
+
+    inline double
+    get(const SumTree* tree, size_t leaf) {
+        assert( leaf < tree->size );
+        return tree->nodes[tree->capacity + leaf];
+    }
+
+    void
+    set(SumTree* tree, size_t leaf, double weight) {
+        assert( leaf < tree->size );
+        assert( weight >= 0. );
+        size_t i = tree->capacity + leaf;
+        tree->nodes[i] = weight;
+        for (i /= 2; i > 0; i /= 2) {
+            tree->nodes[i] = tree->nodes[2 * i] + tree->nodes[2 * i + 1];
+        }
+    }
+
+    inline double
+    total(const SumTree* tree) {
+        return tree->nodes[1];
+    }
+
+    // The leaf whose share of [0, total) contains `u`. Never returns a leaf of weight 0, even when rounding puts `u`
+    // at or past the end of a subtree; the total must be positive.
+    size_t
+    sample(const SumTree* tree, double u) {
+        assert( total(tree) > 0. );
+        size_t i = 1;
+        while (i < tree->capacity) {
+            double left = tree->nodes[2 * i];
+            if ((u < left && left > 0.) || tree->nodes[2 * i + 1] <= 0.) {
+                i = 2 * i;
+            } else {
+                u -= left;
+                i = 2 * i + 1;
+            }
+        }
+        return i - tree->capacity;
+    }
+
+} // end namespace
+
+
+#endif
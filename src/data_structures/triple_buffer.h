@@ -0,0 +1,82 @@
+/*
+A lock-free triple buffer for handing the latest value from one producer thread to one consumer thread.
+
+The producer always owns one slot (`back`) and the consumer another (`front`). The third slot sits in `middle`
+together with a flag saying whether it holds a value the consumer has not seen yet. Publishing swaps back and middle,
+and acquiring swaps front and middle, each with a single atomic exchange. Neither side ever waits. The consumer may
+skip values, but it always gets the newest published one.
+*/
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+
+#include <atomic>
+
+#include "../types.h"
+
+// Set in `middle` when the slot it names has been published but not yet acquired.
+#define TRIPLE_BUFFER_FRESH (4u)
+
+namespace triple_buffer {
+    //// Types
+    template <typename T> struct triple_buffer;
+    template <typename T> using TripleBuffer = triple_buffer<T>;
+
+
+    //// Implementations
+    template <typename T>
+    struct triple_buffer {
+        T slots[3];
+        uint back;  // producer's slot
+        uint front;  // consumer's slot
+        std::atomic<uint> middle;  // slot index, plus TRIPLE_BUFFER_FRESH
+    };
+
+    // Reset a buffer so that the producer owns slot 0, the consumer slot 1, and nothing is published.
+    // Slot contents are left alone, so callers may size them first.
+    template <typename T>
+    void
+    init(TripleBuffer<T>* buffer) {
+        buffer->back = 0;
+        buffer->front = 1;
+        buffer->middle.store(2, std::memory_order_relaxed);
+    }
+
+    // Producer: the slot to fill with the next value. Its previous contents are whatever was published two
+    // values ago (or initial), so fixed-size values can be overwritten in place without reallocating.
+    template <typename T>
+    T*
+    writable(TripleBuffer<T>* buffer) {
+        return &buffer->slots[buffer->back];
+    }
+
+    // Producer: publish the slot returned by writable. A value published but not yet acquired is replaced.
+    template <typename T>
+    void
+    publish(TripleBuffer<T>* buffer) {
+        uint previous = buffer->middle.exchange(buffer->back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel);
+        buffer->back = previous & ~TRIPLE_BUFFER_FRESH;
+    }
+
+    // Consumer: take the most recently published value, if there is one the consumer has not seen yet.
+    // Returns true if the front slot changed.
+    template <typename T>
+    bool
+    acquire(TripleBuffer<T>* buffer) {
+        if ((buffer->middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH) == 0) return false;
+        uint previous = buffer->middle.exchange(buffer->front, std::memory_order_acq_rel);
+        buffer->front = previous & ~TRIPLE_BUFFER_FRESH;
+        return true;
+    }
+
+    // Consumer: the slot acquired last. It stays valid and unchanged until the next acquire.
+    template <typename T>
+    const T*
+    readable(const TripleBuffer<T>* buffer) {
+        return &buffer->slots[buffer->front];
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,284 @@
+/*
+Rejection-free stepping for the voter and Sznajd models.
+
+A plain step samples an edge uniformly and applies the model to it; near consensus almost every sampled edge is
+"inactive" (applying the model to it changes nothing), so most steps are wasted. This engine keeps the set of active
+edges in a dense array with an index (swap-and-pop removal), updated after every opinion change, and samples only
+from it. The plain steps it skips are accounted for exactly: with A active edges out of E, the number of inactive
+steps before the next active one is geometric with success probability A / E, so `steps` advances by that many
+plus one. The sequence of opinion states, and the step count at which each one is reached, has the same
+distribution as with sample_edge.
+
+Each change costs O(degree) bookkeeping instead of O(1), so this pays off when few edges are active (late in a run,
+with opinions in large clusters, on graphs that freeze) and is slower than plain stepping when most edges are.
+
+An edge (u, v) is active for the voter model when u and v disagree. For the Sznajd model it depends on how many of
+each endpoint's out-neighbors disagree with it (`discordant_out`): an agreeing edge is active when either endpoint
+has a disagreeing neighbor, and a disagreeing edge when either endpoint has one besides the other endpoint.
+
+The engine takes a copy of the topology when it is made; the graph's edges must not change while it is in use.
+*/
+#ifndef ACTIVE_LINKS_H
+#define ACTIVE_LINKS_H
+
+
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/graph.h"
+#include "../data_structures/ring_buffer.h"
+#include "diff.h"  // Diff, OpinionChange
+#include "models/voter_model.h"
+#include "models/sznajd.h"
+
+namespace active_links {
+    //// Types
+    typedef struct engine Engine;
+
+    enum rule { RULE_VOTER, RULE_SZNAJD };
+
+    //// forward declarations
+    // structs
+    struct engine;
+
+    // functions
+    Engine* make(graph::Graph*, rule);
+    void destroy(Engine*);
+    inline size_t num_active(const Engine*);
+
+
+    //// Implementations
+    struct engine {
+        graph::Graph* graph;
+        rule model;
+
+        // topology, by edge id (position in graph->edges when the engine was made)
+        std::vector<graph::edge_t> edges;
+        std::vector<uint> out_offsets, out_edges;  // ids of each node's outgoing edges
+        std::vector<uint> in_offsets, in_edges;    // ids of each node's incoming edges
+        std::vector<uint8_t> has_reverse;          // per edge (u, v): (v, u) is an edge too (Sznajd only)
+
+        // opinion-dependent state
+        std::vector<uint8_t> discordant;   // per edge: its endpoints disagree
+        std::vector<uint> discordant_out;  // per node: discordant outgoing edges (Sznajd only)
+        std::vector<uint> active;          // ids of active edges, in no particular order
+        std::vector<uint> position;        // per edge: index in `active`, or graph::NIL
+
+        // nodes whose edges need their activity rechecked after the current step (Sznajd only)
+        std::vector<uint> touched;
+        std::vector<uint8_t> is_touched;
+
+        Diff scratch;    // changes made by the step being applied
+        uint64_t steps;  // plain steps (sampled edges) this run corresponds to
+    };
+
+    inline size_t
+    num_active(const Engine* engine) {
+        return engine->active.size();
+    }
+
+    static bool
+    is_active(const Engine* engine, uint id) {
+        if (engine->model == RULE_VOTER) return engine->discordant[id];
+        uint u = engine->edges[id].first, v = engine->edges[id].second;
+        if (! engine->discordant[id]) return engine->discordant_out[u] + engine->discordant_out[v] > 0;
+        // u's other neighbors take u's opinion, v's neighbors other than u take v's
+        return engine->discordant_out[u] > 1 || engine->discordant_out[v] > engine->has_reverse[id];
+    }
+
+    // Add or remove an edge from the active set to match its current state.
+    static void
+    update(Engine* engine, uint id) {
+        bool active = is_active(engine, id);
+        uint at = engine->position[id];
+        if (active && at == graph::NIL) {
+            engine->position[id] = (uint) engine->active.size();
+            engine->active.push_back(id);
+        } else if (! active && at != graph::NIL) {
+            uint last = engine->active.back();
+            engine->active[at] = last;
+            engine->position[last] = at;
+            engine->active.pop_back();
+            engine->position[id] = graph::NIL;
+        }
+    }
+
+    static inline void
+    touch(Engine* engine, uint node) {
+        if (engine->is_touched[node]) return;
+        engine->is_touched[node] = 1;
+        engine->touched.push_back(node);
+    }
+
+    // Account for one change of `node`'s opinion: every edge at it changes discordance.
+    static inline void
+    flip(Engine* engine, uint node) {
+        bool sznajd = (engine->model == RULE_SZNAJD);
+        for (uint i = engine->out_offsets[node]; i < engine->out_offsets[node + 1]; ++i) {
+            uint id = engine->out_edges[i];
+            engine->discordant[id] ^= 1;
+            if (sznajd) {
+                if (engine->discordant[id]) engine->discordant_out[node]++;
+                else engine->discordant_out[node]--;
+            } else {
+                update(engine, id);
+            }
+        }
+        for (uint i = engine->in_offsets[node]; i < engine->in_offsets[node + 1]; ++i) {
+            uint id = engine->in_edges[i];
+            engine->discordant[id] ^= 1;
+            if (sznajd) {
+                // activity only depends on whether a count is 0, 1 or more
+                uint source = engine->edges[id].first;
+                uint before = engine->discordant_out[source];
+                if (engine->discordant[id]) engine->discordant_out[source]++;
+                else engine->discordant_out[source]--;
+                if (std::min(before, engine->discordant_out[source]) <= 1) touch(engine, source);
+            } else {
+                update(engine, id);
+            }
+        }
+        if (sznajd) touch(engine, node);
+    }
+
+    // Recheck the edges at every touched node.
+    static inline void
+    settle(Engine* engine) {
+        for (uint node : engine->touched) {
+            for (uint i = engine->out_offsets[node]; i < engine->out_offsets[node + 1]; ++i) {
+                update(engine, engine->out_edges[i]);
+            }
+            for (uint i = engine->in_offsets[node]; i < engine->in_offsets[node + 1]; ++i) {
+                update(engine, engine->in_edges[i]);
+            }
+            engine->is_touched[node] = 0;
+        }
+        engine->touched.clear();
+    }
+
+    // Set up an engine for `graph` as it is now, starting at step 0.
+    Engine*
+    make(graph::Graph* graph, rule model) {
+        Engine* engine = new Engine;
+        assert(engine);
+        uint n = (uint) graph->nodes.size();
+        uint m = (uint) graph->edges.size();
+        engine->graph = graph;
+        engine->model = model;
+        engine->edges = graph->edges;
+        engine->steps = 0;
+
+        // incident edge ids per node, by counting sort
+        engine->out_offsets.assign(n + 1, 0);
+        engine->in_offsets.assign(n + 1, 0);
+        for (const auto& edge : engine->edges) {
+            engine->out_offsets[edge.first + 1]++;
+            engine->in_offsets[edge.second + 1]++;
+        }
+        uint max_degree = 0;
+        for (uint v = 0; v < n; ++v) {
+            max_degree = std::max(max_degree, engine->out_offsets[v + 1]);
+            engine->out_offsets[v + 1] += engine->out_offsets[v];
+            engine->in_offsets[v + 1] += engine->in_offsets[v];
+        }
+        engine->out_edges.resize(m);
+        engine->in_edges.resize(m);
+        std::vector<uint> next_out(engine->out_offsets.begin(), engine->out_offsets.end() - 1);
+        std::vector<uint> next_in(engine->in_offsets.begin(), engine->in_offsets.end() - 1);
+        for (uint id = 0; id < m; ++id) {
+            engine->out_edges[next_out[engine->edges[id].first]++] = id;
+            engine->in_edges[next_in[engine->edges[id].second]++] = id;
+        }
+
+        if (model == RULE_SZNAJD) {
+            engine->has_reverse.assign(m, 1);
+            if (! graph->is_undirected) {
+                std::vector<uint64_t> keys(m);
+                for (uint id = 0; id < m; ++id) {
+                    keys[id] = ((uint64_t) engine->edges[id].first << 32) | engine->edges[id].second;
+                }
+                std::sort(keys.begin(), keys.end());
+                for (uint id = 0; id < m; ++id) {
+                    uint64_t reverse = ((uint64_t) engine->edges[id].second << 32) | engine->edges[id].first;
+                    engine->has_reverse[id] = std::binary_search(keys.begin(), keys.end(), reverse);
+                }
+            }
+        }
+
+        engine->discordant.resize(m);
+        engine->discordant_out.assign(n, 0);
+        for (uint id = 0; id < m; ++id) {
+            const auto& edge = engine->edges[id];
+            engine->discordant[id] = graph::opinion(graph, edge.first) != graph::opinion(graph, edge.second);
+            if (engine->discordant[id]) engine->discordant_out[edge.first]++;
+        }
+        engine->position.assign(m, graph::NIL);
+        for (uint id = 0; id < m; ++id) {
+            update(engine, id);
+        }
+        engine->is_touched.assign(n, 0);
+
+        // a Sznajd step changes at most the out-neighbors of both endpoints, some of them twice
+        ring_buffer::init(&engine->scratch, 2 * (size_t) max_degree + 2);
+        return engine;
+    }
+
+    void
+    destroy(Engine* engine) {
+        delete engine;
+    }
+
+    // Apply the model to edge `id` and bring the active set up to date, forwarding the changes to `diff` if given.
+    static inline void
+    apply(Engine* engine, uint id, Diff* diff) {
+        const graph::edge_t& edge = engine->edges[id];
+        if (engine->model == RULE_VOTER) step_voter_dynamics(engine->graph, edge, &engine->scratch);
+        else step_sznajd_dynamics(engine->graph, edge, &engine->scratch);
+        ring_buffer::drain(&engine->scratch, [&](const OpinionChange& change) {
+            flip(engine, change.node);
+            if (diff != nullptr) ring_buffer::push(diff, change);
+        });
+        if (engine->model == RULE_SZNAJD) settle(engine);
+    }
+
+    // Advance until `limit` steps have been taken or `max_changes` active edges applied, whichever comes first.
+    // Stops early, with `steps` at the last change, once there are no active edges: nothing can change any more, and
+    // the caller decides how far to jump. Returns the number of active edges applied.
+    template <typename URBG = decltype(rng::generator)>
+    uint64_t
+    advance(Engine* engine, uint64_t limit, uint64_t max_changes = UINT64_MAX, Diff* diff = nullptr,
+            URBG& gen = rng::generator) {
+        uint64_t applied = 0;
+        double num_edges = (double) engine->edges.size();
+        while (applied < max_changes && engine->steps < limit) {
+            size_t num_active = engine->active.size();
+            if (num_active == 0) break;
+            // inactive steps before the next active one; the wait is memoryless, so stopping at `limit` and drawing
+            // afresh on the next call changes nothing
+            uint64_t skip = 0;
+            if ((double) num_active < num_edges) {
+                std::geometric_distribution<uint64_t> inactive((double) num_active / num_edges);
+                skip = inactive(gen);
+            }
+            if (skip >= limit - engine->steps) {
+                engine->steps = limit;
+                break;
+            }
+            engine->steps += skip + 1;
+
+            std::uniform_int_distribution<size_t> pick(0, num_active - 1);
+            apply(engine, engine->active[pick(gen)], diff);
+            applied++;
+        }
+        return applied;
+    }
+
+} // end namespace
+
+
+#endif
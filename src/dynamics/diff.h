@@ -0,0 +1,52 @@
+/*
+Change records emitted by the dynamics steps. Each record holds one node whose opinion actually changed, with its old
+and new values, so a stream of them can be replayed onto an earlier copy of the opinions, rendered incrementally, or
+logged. Records carry absolute values, so applying one twice is harmless.
+
+Steps push records into a caller-provided ring (see data_structures/ring_buffer.h); passing no ring skips recording.
+*/
+#ifndef DIFF_H
+#define DIFF_H
+
+
+#include <stdint.h>
+
+#include "../types.h"
+#include "../data_structures/graph.h"
+#include "../data_structures/csr.h"
+#include "../data_structures/bitset.h"
+#include "../data_structures/ring_buffer.h"
+
+//// Types
+typedef struct opinion_change OpinionChange;
+typedef ring_buffer::RingBuffer<OpinionChange> Diff;
+
+struct opinion_change {
+    uint node;
+    bool before;
+    bool after;
+};
+
+//// Implementations
+// Set a node's opinion, pushing a change record into `diff` (if any) when the opinion actually changes.
+// Works for graph::Graph and graph::CSR.
+template <typename G>
+inline void
+set_opinion_recorded(G* graph, uint node, bool value, Diff* diff) {
+    bool before = graph::opinion(graph, node);
+    if (before == value) return;
+    graph::set_opinion(graph, node, value);
+    if (diff != nullptr) {
+        OpinionChange change = { node, before, value };
+        ring_buffer::push(diff, change);
+    }
+}
+
+// Apply a change record to an opinion bitset.
+inline void
+apply_change(bitset::Bitset* opinion, const OpinionChange& change) {
+    bitset::set(opinion, change.node, change.after);
+}
+
+
+#endif
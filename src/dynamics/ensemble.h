@@ -0,0 +1,170 @@
+/*
+Ensembles: many independent runs of a model, over one or more parameter points, on a thread pool.
+
+A point is a frozen topology, a step rule, a step limit and a number of replicas. Every replica gets private opinions
+on a CSR that borrows the point's topology (graph::share), so the topology is stored once however many replicas run
+on it, and its own random stream, rng::stream(master seed, stream_id(point, replica)), so results do not depend on
+which thread ran what and any one replica can be replayed on its own with run_replica. Each replica is one pool task;
+it runs to consensus or to the step limit, and its result is handed to the sink as soon as it finishes. Sink calls
+are serialized, so a sink may write to a file or fold results into a summary without locking.
+
+Opinion changes are counted as they happen, so the consensus step recorded is exact.
+*/
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+
+#include <math.h>
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../thread_pool.h"
+#include "../data_structures/csr.h"
+#include "../data_structures/bitset.h"
+#include "../data_structures/ring_buffer.h"
+#include "diff.h"  // Diff, OpinionChange
+#include "utils.h"  // sample_edge, init_opinions
+
+namespace ensemble {
+    //// Types
+    typedef struct point Point;
+    typedef struct result Result;
+    typedef struct summary Summary;
+
+    // the per-step action: one of the step_*_dynamics rules for frozen graphs
+    typedef void (*step_rule)(graph::CSR*, const graph::edge_t&, Diff*);
+    typedef std::function<void(const Result&)> Sink;
+
+    //// forward declarations
+    // structs
+    struct point;
+    struct result;
+    struct summary;
+
+    // functions
+    inline uint64_t stream_id(uint, uint);
+    Result run_replica(const Point*, uint, uint, uint64_t);
+    void run(thread_pool::Pool*, const std::vector<Point>&, uint64_t, Sink);
+    void add(Summary*, const Result&);
+    double stddev_steps(const Summary*);
+
+
+    //// Implementations
+    struct point {
+        const graph::CSR* topology;  // shared by every replica; its own opinions are not used
+        step_rule rule;
+        uint64_t max_steps;  // 0 runs until consensus
+        uint replicas;
+    };
+
+    struct result {
+        uint point;
+        uint replica;
+        uint64_t steps;       // steps taken; the consensus step if consensus was reached
+        bool consensus;
+        double magnetization; // final (true - false) / nodes
+    };
+
+    // Running statistics of a point's results (Welford's algorithm for the step variance).
+    struct summary {
+        uint64_t count{ 0 };
+        uint64_t consensus{ 0 };
+        double mean_steps{ 0. };
+        double m2_steps{ 0. };
+        double mean_abs_magnetization{ 0. };
+    };
+
+    // Random stream id of a replica. Always below RNG_STREAM_NAMED, so no replica shares a stream with
+    // rng::generator (which built the graph) or any other named stream of the same master seed.
+    inline uint64_t
+    stream_id(uint point, uint replica) {
+        assert( point < (1u << 31) );
+        return ((uint64_t) point << 32) | replica;
+    }
+
+    // Run one replica of `point` with opinions and random stream of its own.
+    Result
+    run_replica(const Point* point, uint point_index, uint replica, uint64_t master_seed) {
+        rng::Philox gen = rng::stream(master_seed, stream_id(point_index, replica));
+
+        graph::CSR* graph = graph::share(point->topology);
+        init_opinions(&graph->properties, gen);
+        uint num_nodes = graph->num_nodes;
+        uint num_true = (uint) bitset::count(&graph->properties.opinion);
+
+        // a Sznajd step changes at most the out-neighbors of both endpoints, some of them twice
+        uint max_degree = 0;
+        for (uint v = 0; v < num_nodes; ++v) {
+            max_degree = std::max(max_degree, graph->offsets[v + 1] - graph->offsets[v]);
+        }
+        Diff changes;
+        ring_buffer::init(&changes, 2 * (size_t) max_degree + 2);
+
+        uint64_t limit = (point->max_steps == 0) ? UINT64_MAX : point->max_steps;
+        uint64_t steps = 0;
+        bool consensus = (num_true == 0 || num_true == num_nodes);
+        while (! consensus && steps < limit && graph->num_edges > 0) {
+            point->rule(graph, sample_edge(graph, gen), &changes);
+            steps++;
+            ring_buffer::drain(&changes, [&](const OpinionChange& change) {
+                if (change.after) num_true++;
+                else num_true--;
+            });
+            consensus = (num_true == 0 || num_true == num_nodes);
+        }
+
+        Result result;
+        result.point = point_index;
+        result.replica = replica;
+        result.steps = steps;
+        result.consensus = consensus;
+        result.magnetization = (num_nodes > 0) ? (2. * num_true - (double) num_nodes) / num_nodes : 0.;
+        graph::destroy(graph);
+        return result;
+    }
+
+    // Run every replica of every point on `pool`, handing each result to `sink` as it comes in. Returns when all
+    // have finished.
+    void
+    run(thread_pool::Pool* pool, const std::vector<Point>& points, uint64_t master_seed, Sink sink) {
+        std::mutex sink_lock;
+        for (uint p = 0; p < points.size(); ++p) {
+            for (uint r = 0; r < points[p].replicas; ++r) {
+                const Point* point = &points[p];
+                thread_pool::submit(pool, [point, p, r, master_seed, &sink, &sink_lock] {
+                    Result result = run_replica(point, p, r, master_seed);
+                    std::lock_guard<std::mutex> guard(sink_lock);
+                    sink(result);
+                });
+            }
+        }
+        thread_pool::wait(pool);
+    }
+
+    void
+    add(Summary* summary, const Result& result) {
+        summary->count++;
+        summary->consensus += result.consensus;
+        double delta = (double) result.steps - summary->mean_steps;
+        summary->mean_steps += delta / (double) summary->count;
+        summary->m2_steps += delta * ((double) result.steps - summary->mean_steps);
+        summary->mean_abs_magnetization +=
+            (fabs(result.magnetization) - summary->mean_abs_magnetization) / (double) summary->count;
+    }
+
+    double
+    stddev_steps(const Summary* summary) {
+        return (summary->count > 1) ? sqrt(summary->m2_steps / (double) (summary->count - 1)) : 0.;
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,131 @@
+/*
+Continuous-time (Gillespie) runs with a rate per node.
+
+Each node acts as a Poisson process with its own rate: at each event one node is chosen with probability proportional
+to its rate, it picks one of its neighbors uniformly, and the model's step rule is applied to that edge. The waiting
+time before each event is exponential with the total rate, so `time` is the physical time of the run and `events`
+its step count. Rates live in a sum tree, so choosing a node and changing a rate both take O(log N).
+
+With every rate equal to the node's degree this is plain edge sampling run in continuous time; with uniform rates
+every node acts equally often whatever its degree. Stubborn agents are nodes with a low rate. A node with rate 0
+never acts, though its neighbors can still change its opinion under rules that update both endpoints (Sznajd).
+*/
+#ifndef GILLESPIE_H
+#define GILLESPIE_H
+
+
+#include <math.h>
+#include <stdint.h>
+#include <assert.h>
+#include <random>
+#include <vector>
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/graph.h"
+#include "../data_structures/sum_tree.h"
+#include "diff.h"  // Diff
+
+namespace gillespie {
+    //// Types
+    typedef struct engine Engine;
+
+    // the per-event action: one of the step_*_dynamics rules
+    typedef void (*step_rule)(graph::Graph*, const graph::edge_t&, Diff*);
+
+    //// forward declarations
+    // structs
+    struct engine;
+
+    // functions
+    Engine* make(graph::Graph*, step_rule, const std::vector<double>&);
+    void destroy(Engine*);
+    std::vector<double> degree_rates(const graph::Graph*);
+    void set_rate(Engine*, uint, double);
+    inline double total_rate(const Engine*);
+
+
+    //// Implementations
+    struct engine {
+        graph::Graph* graph;
+        step_rule rule;
+        sum_tree::SumTree rates;  // per node
+        double time;      // physical time of the last event
+        uint64_t events;  // events (steps) so far
+    };
+
+    // Set up an engine at time 0 with one rate per node of `graph`.
+    Engine*
+    make(graph::Graph* graph, step_rule rule, const std::vector<double>& rates) {
+        assert( rates.size() == graph->nodes.size() );
+        Engine* engine = new Engine;
+        assert(engine);
+        engine->graph = graph;
+        engine->rule = rule;
+        sum_tree::assign(&engine->rates, rates);
+        engine->time = 0.;
+        engine->events = 0;
+        return engine;
+    }
+
+    void
+    destroy(Engine* engine) {
+        delete engine;
+    }
+
+    // Rates equal to each node's out-degree, which makes every edge equally likely to be stepped.
+    std::vector<double>
+    degree_rates(const graph::Graph* graph) {
+        std::vector<double> rates(graph->nodes.size());
+        for (uint v = 0; v < graph->nodes.size(); ++v) {
+            rates[v] = (double) graph->nodes[v]->num_adjacent;
+        }
+        return rates;
+    }
+
+    // Change one node's rate; takes effect from the next event on.
+    void
+    set_rate(Engine* engine, uint node, double rate) {
+        sum_tree::set(&engine->rates, node, rate);
+    }
+
+    inline double
+    total_rate(const Engine* engine) {
+        return sum_tree::total(&engine->rates);
+    }
+
+    // Run events until `limit` events have happened or the next one would come after `until`, whichever is first,
+    // pushing opinion changes into `diff` if given. If every rate is 0 nothing can happen, and it stops early.
+    // Returns the number of events run.
+    template <typename URBG = decltype(rng::generator)>
+    uint64_t
+    advance(Engine* engine, uint64_t limit, double until = INFINITY, Diff* diff = nullptr,
+            URBG& gen = rng::generator) {
+        uint64_t run = 0;
+        std::uniform_real_distribution<double> uniform(0., 1.);
+        while (engine->events < limit) {
+            double total = total_rate(engine);
+            if (! (total > 0.)) break;
+            // the wait is memoryless, so an event drawn past `until` can be dropped and redrawn next call
+            double wait = std::exponential_distribution<double>(total)(gen);
+            if (engine->time + wait > until) {
+                engine->time = until;
+                break;
+            }
+            engine->time += wait;
+            engine->events++;
+            run++;
+
+            uint node = (uint) sum_tree::sample(&engine->rates, uniform(gen) * total);
+            const graph::Node* actor = engine->graph->nodes[node];
+            if (actor->num_adjacent == 0) continue;  // nobody to interact with
+            std::uniform_int_distribution<uint> pick(0, actor->num_adjacent - 1);
+            engine->rule(engine->graph, graph::edge_t(node, actor->adjacent[pick(gen)]), diff);
+        }
+        return run;
+    }
+
+} // end namespace
+
+
+#endif
@@ -10,32 +10,66 @@
 #include "../../types.h"
 #include "../../random.h"  // rng::
 #include "../../data_structures/graph.h"  // graph::
+#include "../../data_structures/csr.h"  // graph::CSR
+#include "../diff.h"  // Diff, set_opinion_recorded
 
+// If `diff` is given, every neighbor whose opinion changes is pushed into it.
 void
-step_sznajd_dynamics(graph::Graph* graph, graph::edge_ptr_t& edge) {
-    if (edge.first == nullptr || edge.second == nullptr) return;
+step_sznajd_dynamics(graph::Graph* graph, const graph::edge_t& edge, Diff* diff = nullptr) {
+    if (edge.first == graph::NIL || edge.second == graph::NIL) return;
 
-    bool opinion1 = edge.first->properties->opinion;
-    bool opinion2 = edge.second->properties->opinion;
+    bool opinion1 = graph::opinion(graph, edge.first);
+    bool opinion2 = graph::opinion(graph, edge.second);
+    const graph::Node* first = graph->nodes[edge.first];
+    const graph::Node* second = graph->nodes[edge.second];
 
     if (opinion1 == opinion2) {
         // All neighbors take this opinion.
-        for (uint n = 0; n < edge.first->num_adjacent; ++n) {
-            // TODO: this way of getting the neighbor is fucking stupid
-            graph->nodes[ edge.first->adjacent[n] ]->properties->opinion = opinion1;
+        for (uint n = 0; n < first->num_adjacent; ++n) {
+            set_opinion_recorded(graph, first->adjacent[n], opinion1, diff);
         }
-        for (uint n = 0; n < edge.second->num_adjacent; ++n) {
-            graph->nodes[ edge.second->adjacent[n] ]->properties->opinion = opinion1;
+        for (uint n = 0; n < second->num_adjacent; ++n) {
+            set_opinion_recorded(graph, second->adjacent[n], opinion1, diff);
         }
     } else {
         // Neighbors take corresponding opinions.
-        for (uint n = 0; n < edge.first->num_adjacent; ++n) {
-            if (graph->nodes[n] == edge.second) continue;
-            graph->nodes[ edge.first->adjacent[n] ]->properties->opinion = opinion1;
+        for (uint n = 0; n < first->num_adjacent; ++n) {
+            if (first->adjacent[n] == edge.second) continue;
+            set_opinion_recorded(graph, first->adjacent[n], opinion1, diff);
         }
-        for (uint n = 0; n < edge.second->num_adjacent; ++n) {
-            if (graph->nodes[n] == edge.first) continue;
-            graph->nodes[ edge.second->adjacent[n] ]->properties->opinion = opinion2;
+        for (uint n = 0; n < second->num_adjacent; ++n) {
+            if (second->adjacent[n] == edge.first) continue;
+            set_opinion_recorded(graph, second->adjacent[n], opinion2, diff);
+        }
+    }
+}
+
+// Same as above, for a frozen graph.
+void
+step_sznajd_dynamics(graph::CSR* graph, const graph::edge_t& edge, Diff* diff = nullptr) {
+    if (edge.first == graph::NIL || edge.second == graph::NIL) return;
+
+    bool opinion1 = graph::opinion(graph, edge.first);
+    bool opinion2 = graph::opinion(graph, edge.second);
+
+    const uint* neighbors = graph->neighbors;
+    if (opinion1 == opinion2) {
+        // All neighbors take this opinion.
+        for (uint i = graph->offsets[edge.first]; i < graph->offsets[edge.first + 1]; ++i) {
+            set_opinion_recorded(graph, neighbors[i], opinion1, diff);
+        }
+        for (uint i = graph->offsets[edge.second]; i < graph->offsets[edge.second + 1]; ++i) {
+            set_opinion_recorded(graph, neighbors[i], opinion1, diff);
+        }
+    } else {
+        // Neighbors take corresponding opinions.
+        for (uint i = graph->offsets[edge.first]; i < graph->offsets[edge.first + 1]; ++i) {
+            if (neighbors[i] == edge.second) continue;
+            set_opinion_recorded(graph, neighbors[i], opinion1, diff);
+        }
+        for (uint i = graph->offsets[edge.second]; i < graph->offsets[edge.second + 1]; ++i) {
+            if (neighbors[i] == edge.first) continue;
+            set_opinion_recorded(graph, neighbors[i], opinion2, diff);
         }
     }
 }
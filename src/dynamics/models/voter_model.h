@@ -8,20 +8,31 @@
 
 #include "../../random.h"  // rng::
 #include "../../data_structures/graph.h"  // graph::
+#include "../../data_structures/csr.h"  // graph::CSR
+#include "../diff.h"  // Diff, set_opinion_recorded
 
 // Sample a pair of nodes by randomly sampling an edge.
+// If `diff` is given, the change (if any) is pushed into it.
 void
-step_voter_dynamics(graph::Graph* graph, graph::edge_ptr_t& edge) {
-    if (edge.first == nullptr || edge.second == nullptr) return;
+step_voter_dynamics(graph::Graph* graph, const graph::edge_t& edge, Diff* diff = nullptr) {
+    if (edge.first == graph::NIL || edge.second == graph::NIL) return;
 
-    bool opinion1 = edge.first->properties->opinion;
-    bool opinion2 = edge.second->properties->opinion;
+    bool opinion1 = graph::opinion(graph, edge.first);
+    bool opinion2 = graph::opinion(graph, edge.second);
 
     // if the opinions differ, then target changes its opinion to that of its selected neighbor
     if (opinion1 != opinion2) {
-        edge.first->properties->opinion = opinion2;
+        set_opinion_recorded(graph, edge.first, opinion2, diff);
     }
 }
 
+// Same as above, for a frozen graph.
+void
+step_voter_dynamics(graph::CSR* graph, const graph::edge_t& edge, Diff* diff = nullptr) {
+    if (edge.first == graph::NIL || edge.second == graph::NIL) return;
+
+    set_opinion_recorded(graph, edge.first, graph::opinion(graph, edge.second), diff);
+}
+
 
 #endif
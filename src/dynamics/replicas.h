@@ -0,0 +1,266 @@
+/*
+Many voter-model replicas on one frozen topology, packed one replica per bit.
+
+Each node's opinion is a block of REPLICA_WORDS 64-bit words, one bit per replica ("lane"), so one walk over a node's
+adjacency list serves every replica at once and the topology is stored once for all of them. A step samples an edge
+uniformly as sample_edge does and updates its source in every lane; each lane then copies its own uniformly chosen
+neighbor. The choice is bit-sliced: lane indices are made of random bits, one random word per index bit, and the
+neighbors' opinion blocks are reduced pairwise through a tree of selects, so a node of degree d costs O(d) block
+operations for all lanes together. Lanes whose index lands past d (when d is not a power of two) draw again.
+
+Every lane on its own is an exact run of the voter model with edge sampling, but the lanes share the sequence of
+updated nodes, so they are not independent of each other: replicas are correlated, and statistics need that taken into
+account (e.g. by pooling results from several engines with different seeds).
+
+With AVX2 or AVX-512 enabled at compile time (e.g. -march=native, see OPINION_DYNAMICS_NATIVE in CMakeLists.txt), a
+block is 256 or 512 bits and the selects run as single vector instructions.
+*/
+#ifndef REPLICAS_H
+#define REPLICAS_H
+
+
+#include <stdint.h>
+#include <assert.h>
+#include <random>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/csr.h"
+#include "../data_structures/bitset.h"  // bitset::ctz
+#include "utils.h"  // sample_edge
+
+// 64-bit words per opinion block: one vector register when the target has one
+#if defined(__AVX512F__)
+#define REPLICA_WORDS 8
+#elif defined(__AVX2__)
+#define REPLICA_WORDS 4
+#else
+#define REPLICA_WORDS 1
+#endif
+#define REPLICA_LANES (64 * REPLICA_WORDS)
+
+namespace replicas {
+    //// Types
+    typedef struct block Block;
+    typedef struct engine Engine;
+
+    //// forward declarations
+    // structs
+    struct block;
+    struct engine;
+
+    // functions
+    inline Block select(const Block&, const Block&, const Block&);
+    inline bool opinion(const Engine*, uint, uint);
+    void destroy(Engine*);
+    void update(Engine*, uint);
+    void step(Engine*);
+    void advance(Engine*, uint64_t);
+    uint num_consensus(const Engine*);
+
+
+    //// Implementations
+    struct alignas(8 * REPLICA_WORDS) block {
+        uint64_t words[REPLICA_WORDS];
+    };
+
+    // Per lane: b where mask is set, a elsewhere.
+    inline Block
+    select(const Block& a, const Block& b, const Block& mask) {
+        Block out;
+    #if defined(__AVX512F__)
+        __m512i va = _mm512_load_si512((const void*) a.words);
+        __m512i vb = _mm512_load_si512((const void*) b.words);
+        __m512i vm = _mm512_load_si512((const void*) mask.words);
+        _mm512_store_si512((void*) out.words, _mm512_ternarylogic_epi64(vm, vb, va, 0xCA));
+    #elif defined(__AVX2__)
+        __m256i va = _mm256_load_si256((const __m256i*) a.words);
+        __m256i vb = _mm256_load_si256((const __m256i*) b.words);
+        __m256i vm = _mm256_load_si256((const __m256i*) mask.words);
+        __m256i vout = _mm256_or_si256(_mm256_andnot_si256(vm, va), _mm256_and_si256(vm, vb));
+        _mm256_store_si256((__m256i*) out.words, vout);
+    #else
+        for (int w = 0; w < REPLICA_WORDS; ++w) {
+            out.words[w] = (a.words[w] & ~mask.words[w]) | (b.words[w] & mask.words[w]);
+        }
+    #endif
+        return out;
+    }
+
+    struct engine {
+        const graph::CSR* graph;  // shared topology, not owned
+        std::vector<Block> opinions;       // per node
+        std::vector<uint> num_true;        // per lane: nodes holding opinion true
+        std::vector<uint64_t> consensus;   // per lane: step at which consensus was reached, or UINT64_MAX
+        uint64_t steps;
+        rng::Philox bits;  // random lane bits
+
+        // scratch for update
+        std::vector<Block> values;
+        std::vector<Block> index_bits;
+    };
+
+    inline bool
+    opinion(const Engine* engine, uint node, uint lane) {
+        return (engine->opinions[node].words[lane / 64] >> (lane % 64)) & 1;
+    }
+
+    static inline Block
+    random_block(Engine* engine) {
+        Block out;
+        for (int w = 0; w < REPLICA_WORDS; ++w) out.words[w] = engine->bits();
+        return out;
+    }
+
+    static void
+    check_consensus(Engine* engine, uint lane) {
+        uint count = engine->num_true[lane];
+        if ((count == 0 || count == engine->graph->num_nodes) && engine->consensus[lane] == UINT64_MAX) {
+            engine->consensus[lane] = engine->steps;
+        }
+    }
+
+    // REPLICA_LANES replicas of `graph`, with uniform-random opinions drawn independently per lane.
+    // `graph` must outlive the engine; its own opinions are not used.
+    template <typename URBG = decltype(rng::generator)>
+    Engine*
+    make(const graph::CSR* graph, URBG& gen = rng::generator) {
+        Engine* engine = new Engine;
+        assert(engine);
+        engine->graph = graph;
+        engine->steps = 0;
+        engine->bits = rng::stream(std::uniform_int_distribution<uint64_t>()(gen), RNG_STREAM_MAIN);
+        engine->opinions.resize(graph->num_nodes);
+        engine->num_true.assign(REPLICA_LANES, 0);
+        engine->consensus.assign(REPLICA_LANES, UINT64_MAX);
+        for (auto& block : engine->opinions) {
+            block = random_block(engine);
+            for (int w = 0; w < REPLICA_WORDS; ++w) {
+                for (uint64_t word = block.words[w]; word != 0; word &= word - 1) {
+                    engine->num_true[64 * w + bitset::ctz(word)]++;
+                }
+            }
+        }
+        for (uint lane = 0; lane < REPLICA_LANES; ++lane) check_consensus(engine, lane);
+        return engine;
+    }
+
+    void
+    destroy(Engine* engine) {
+        delete engine;
+    }
+
+    // Every lane copies the opinion of its own uniformly chosen out-neighbor of `node`.
+    void
+    update(Engine* engine, uint node) {
+        const graph::CSR* graph = engine->graph;
+        const uint* neighbors = graph->neighbors + graph->offsets[node];
+        uint degree = graph->offsets[node + 1] - graph->offsets[node];
+        if (degree == 0) return;
+
+        Block chosen, zero;
+        for (int w = 0; w < REPLICA_WORDS; ++w) {
+            chosen.words[w] = 0;
+            zero.words[w] = 0;
+        }
+        if (degree > REPLICA_LANES) {
+            // the select tree would touch more blocks than there are lanes: draw each lane's neighbor directly
+            std::uniform_int_distribution<uint> pick(0, degree - 1);
+            for (uint lane = 0; lane < REPLICA_LANES; ++lane) {
+                uint64_t bit = (uint64_t) opinion(engine, neighbors[pick(engine->bits)], lane);
+                chosen.words[lane / 64] |= bit << (lane % 64);
+            }
+        } else {
+            uint levels = 0;
+            while ((1u << levels) < degree) levels++;
+            engine->values.resize((size_t) 1 << levels);
+            engine->index_bits.resize(levels);
+
+            Block pending;
+            for (int w = 0; w < REPLICA_WORDS; ++w) pending.words[w] = ~(uint64_t) 0;
+            bool any_pending = true;
+            while (any_pending) {
+                // index bit k of every lane, and which pending lanes' indices are below `degree`, compared from the
+                // top bit down
+                for (uint k = 0; k < levels; ++k) engine->index_bits[k] = random_block(engine);
+                Block below = pending;
+                if (degree != (1u << levels)) {
+                    Block equal = pending;
+                    below = zero;
+                    for (int k = (int) levels - 1; k >= 0; --k) {
+                        const Block& r = engine->index_bits[k];
+                        for (int w = 0; w < REPLICA_WORDS; ++w) {
+                            if ((degree >> k) & 1) {
+                                below.words[w] |= equal.words[w] & ~r.words[w];
+                                equal.words[w] &= r.words[w];
+                            } else {
+                                equal.words[w] &= ~r.words[w];
+                            }
+                        }
+                    }
+                }
+                // reduce the neighbors' blocks pairwise, lowest index bit first
+                for (uint j = 0; j < engine->values.size(); ++j) {
+                    engine->values[j] = (j < degree) ? engine->opinions[neighbors[j]] : zero;
+                }
+                for (uint k = 0; k < levels; ++k) {
+                    size_t half = engine->values.size() >> (k + 1);
+                    for (size_t i = 0; i < half; ++i) {
+                        engine->values[i] = select(engine->values[2 * i], engine->values[2 * i + 1],
+                            engine->index_bits[k]);
+                    }
+                }
+                any_pending = false;
+                for (int w = 0; w < REPLICA_WORDS; ++w) {
+                    chosen.words[w] |= engine->values[0].words[w] & below.words[w];
+                    pending.words[w] &= ~below.words[w];
+                    any_pending |= (pending.words[w] != 0);
+                }
+            }
+        }
+
+        // keep the per-lane counts, and with them consensus, up to date
+        Block& current = engine->opinions[node];
+        for (int w = 0; w < REPLICA_WORDS; ++w) {
+            for (uint64_t changed = current.words[w] ^ chosen.words[w]; changed != 0; changed &= changed - 1) {
+                uint bit = bitset::ctz(changed);
+                uint lane = 64 * w + bit;
+                if ((chosen.words[w] >> bit) & 1) engine->num_true[lane]++;
+                else engine->num_true[lane]--;
+                check_consensus(engine, lane);
+            }
+        }
+        current = chosen;
+    }
+
+    // One step in every lane: sample an edge and update its source.
+    void
+    step(Engine* engine) {
+        engine->steps++;
+        graph::edge_t edge = sample_edge(engine->graph);
+        if (edge.first == graph::NIL) return;
+        update(engine, edge.first);
+    }
+
+    void
+    advance(Engine* engine, uint64_t num_steps) {
+        for (uint64_t i = 0; i < num_steps; ++i) step(engine);
+    }
+
+    // Lanes that have reached consensus. The voter model never leaves it.
+    uint
+    num_consensus(const Engine* engine) {
+        uint count = 0;
+        for (uint64_t step : engine->consensus) count += (step != UINT64_MAX);
+        return count;
+    }
+
+} // end namespace
+
+
+#endif
@@ -2,53 +2,111 @@
 #define UTILS
 
 
+#include <algorithm>
 #include <tuple>
 #include <random>
+#include <vector>
 
 #include "../types.h"
 #include "../random.h"
 #include "../data_structures/graph.h"
+#include "../data_structures/csr.h"
 
 
-graph::edge_ptr_t
-sample_edge(const graph::Graph* graph) {
-    if (graph->edges.empty()) return std::make_pair(nullptr, nullptr);
+// Sample an edge uniformly at random in O(1) by indexing into the dense edge list.
+// Returns pair(graph::NIL, graph::NIL) if the graph has no edges.
+template <typename URBG = decltype(rng::generator)>
+graph::edge_t
+sample_edge(const graph::Graph* graph, URBG& gen = rng::generator) {
+    if (graph->edges.empty()) return std::make_pair(graph::NIL, graph::NIL);
 
-    static std::uniform_int_distribution dist( 0, (int) graph->edges.size() - 1 );
+    std::uniform_int_distribution<size_t> dist( 0, graph->edges.size() - 1 );
+    return graph->edges[ dist(gen) ];
+}
+
+// Sample an edge uniformly at random from a frozen graph.
+// O(log n) to recover the source node from the edge's position in the neighbor array.
+// Returns pair(graph::NIL, graph::NIL) if the graph has no edges.
+template <typename URBG = decltype(rng::generator)>
+graph::edge_t
+sample_edge(const graph::CSR* graph, URBG& gen = rng::generator) {
+    if (graph->num_edges == 0) return std::make_pair(graph::NIL, graph::NIL);
+
+    std::uniform_int_distribution<uint> dist( 0, graph->num_edges - 1 );
+    uint idx = dist(gen);
+    // the source is the last node whose adjacency run starts at or before idx
+    uint source = (uint) (std::upper_bound(graph->offsets, graph->offsets + graph->num_nodes + 1, idx) - graph->offsets) - 1;
+    return std::make_pair( source, graph->neighbors[idx] );
+}
 
-    // TODO: O(n) search for edge is inefficient.
-    graph::edge_t edge;
-    int idx = dist(rng::generator);
-    int count = 0;
-    for (auto e : graph->edges) {
-        if (idx == count) {
-            edge = e;
-            break;
-        }
-        count++;
+// Uniform-random opinions, drawn 64 nodes at a time.
+template <typename URBG = decltype(rng::generator)>
+void
+init_opinions(graph::Properties* properties, URBG& gen = rng::generator) {
+    std::uniform_int_distribution<uint64_t> dist;
+    for (auto& word : properties->opinion.words) {
+        word = dist(gen);
+    }
+    if (! properties->opinion.words.empty()) {
+        properties->opinion.words.back() &= bitset::tail_mask(&properties->opinion);
     }
-    return std::make_pair( graph->nodes[edge.first], graph->nodes[edge.second] );
+}
+
+// Count of nodes holding each opinion, as (false, true).
+std::pair<uint, uint>
+opinion_histogram(const graph::Properties* properties) {
+    uint num_true = (uint) bitset::count(&properties->opinion);
+    return std::make_pair( (uint) properties->opinion.size - num_true, num_true );
+}
+
+// Count of nodes holding each opinion within each block, as (false, true) per block.
+// Empty if the graph has no block membership.
+std::vector<std::pair<uint, uint>>
+block_opinion_histogram(const graph::Properties* properties) {
+    std::vector<std::pair<uint, uint>> histogram;
+    for (uint i = 0; i < properties->block.size(); ++i) {
+        uint b = properties->block[i];
+        if (b >= histogram.size()) histogram.resize(b + 1, std::make_pair(0u, 0u));
+        if (bitset::get(&properties->opinion, i)) histogram[b].second++;
+        else histogram[b].first++;
+    }
+    return histogram;
+}
+
+bool
+is_consensus_reached(const graph::Properties* properties) {
+    auto histogram = opinion_histogram(properties);
+    return histogram.first == 0 || histogram.second == 0;
 }
 
 void 
 init_graph_opinions(graph::Graph* graph) {
-    std::bernoulli_distribution dist(0.5);
+    init_opinions(&graph->properties);
+}
 
-    for (uint i = 0; i < graph->nodes.size(); ++i) {
-        graph->nodes[i]->properties->opinion = dist(rng::generator);
-    }
+std::pair<uint, uint>
+opinion_histogram(const graph::Graph* graph) {
+    return opinion_histogram(&graph->properties);
 }
 
 bool
 is_consensus_reached(graph::Graph* graph) {
-    bool opinion = graph->nodes[0]->properties->opinion;
+    return is_consensus_reached(&graph->properties);
+}
 
-    for (uint i = 0; i < graph->nodes.size(); ++i) {
-        if (graph->nodes[i]->properties->opinion != opinion) {
-            return false;
-        }
-    }
-    return true;
+void
+init_graph_opinions(graph::CSR* graph) {
+    init_opinions(&graph->properties);
+}
+
+std::pair<uint, uint>
+opinion_histogram(const graph::CSR* graph) {
+    return opinion_histogram(&graph->properties);
+}
+
+bool
+is_consensus_reached(graph::CSR* graph) {
+    return is_consensus_reached(&graph->properties);
 }
 
 
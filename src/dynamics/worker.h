@@ -0,0 +1,334 @@
+/*
+Runs a scenario's dynamics on a dedicated thread, decoupled from whoever is watching it.
+
+The worker steps as fast as it can, or at a requested rate, with the scenario's sampler: plain edge sampling, or the
+active-link or Gillespie engine, whose skipped steps and events count as steps. About WORKER_PUBLISH_HZ times per
+second (and after every batch when rate-limited) it copies the opinion bitset into a triple buffer. Readers such as
+the renderer take the newest copy with worker::latest, and the two sides never block each other.
+A worker may also be given a ring to push every opinion change into, for a reader that applies changes incrementally
+(see worker::follow). When that ring overflows, the reader resynchronizes from a snapshot, which records where in the
+change stream it was taken.
+
+While the worker runs it owns the graph's opinions and topology. Other threads may still read and write the position
+columns, which the dynamics never touch.
+*/
+#ifndef WORKER_H
+#define WORKER_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/graph.h"
+#include "../data_structures/bitset.h"
+#include "../data_structures/triple_buffer.h"
+#include "../io/scenario.h"  // io::step, io::make_engine, io::make_clock, io::is_finished, io::write_outputs
+#include "active_links.h"
+#include "gillespie.h"
+#include "diff.h"  // Diff
+#include "utils.h"
+
+// Upper bound on how often an unthrottled worker publishes a snapshot.
+#define WORKER_PUBLISH_HZ (240.)
+// Largest number of steps taken between checks of the clock and of the control flags.
+#define WORKER_MAX_BATCH (1 << 14)
+
+namespace worker {
+    //// Types
+    typedef struct snapshot Snapshot;
+    typedef struct worker Worker;
+    typedef struct follower Follower;
+
+    //// forward declarations
+    // structs
+    struct snapshot;
+    struct worker;
+    struct follower;
+
+    // functions
+    Worker* start(graph::Graph*, io::Scenario*, double, bool, Diff*);
+    void stop(Worker*);
+    void set_paused(Worker*, bool);
+    void set_rate(Worker*, double);
+    const Snapshot* latest(Worker*);
+    void init_follower(Worker*, Follower*);
+    template <typename F> bool follow(Worker*, Follower*, F);
+
+
+    //// Implementations
+    // A consistent view of the simulation, as of the end of step `step`.
+    struct snapshot {
+        uint64_t step;
+        bitset::Bitset opinion;
+        std::pair<uint, uint> histogram;  // (false, true)
+        bool finished;  // the scenario's stopping condition has been met
+
+        // where in the worker's change ring this snapshot was taken: it reflects every change before diff_position,
+        // and everything dropped before reset number diff_epoch
+        uint64_t diff_epoch;
+        uint64_t diff_position;
+    };
+
+    struct worker {
+        graph::Graph* graph;
+        io::Scenario* scenario;
+        Diff* diff;  // receives every opinion change, or nullptr
+        rng::Philox gen;  // the worker's own random stream, so it never shares rng::generator with other threads
+        active_links::Engine* engine;  // the scenario's active_links sampler, or nullptr
+        gillespie::Engine* clock;      // the scenario's gillespie sampler, or nullptr
+        std::thread thread;
+
+        // control, written by other threads
+        std::atomic<bool> quit;
+        std::atomic<bool> paused;
+        std::atomic<double> rate;  // steps per second, 0 for as fast as possible
+
+        // progress, written by the worker
+        std::atomic<uint64_t> steps;
+        std::atomic<bool> finished;
+
+        triple_buffer::TripleBuffer<Snapshot> snapshots;
+    };
+
+    // A reader's own copy of the worker's opinions, kept current from the worker's change ring.
+    struct follower {
+        bitset::Bitset opinion;
+        uint64_t epoch;  // change-ring epoch the copy is synchronized with
+        bool resyncing;  // waiting for a snapshot tagged with `epoch`
+    };
+
+    // Publish the current state, and return the change-ring epoch it was tagged with.
+    static uint64_t
+    publish(Worker* worker) {
+        Snapshot* snapshot = triple_buffer::writable(&worker->snapshots);
+        snapshot->step = worker->steps.load(std::memory_order_relaxed);
+        // same size every time, so this copies into the slot's existing words
+        snapshot->opinion = worker->graph->properties.opinion;
+        snapshot->histogram = opinion_histogram(worker->graph);
+        snapshot->finished = worker->finished.load(std::memory_order_relaxed);
+        snapshot->diff_epoch = (worker->diff != nullptr) ? worker->diff->epoch.load(std::memory_order_acquire) : 0;
+        snapshot->diff_position = (worker->diff != nullptr) ? ring_buffer::position(worker->diff) : 0;
+        uint64_t epoch = snapshot->diff_epoch;
+        triple_buffer::publish(&worker->snapshots);
+        return epoch;
+    }
+
+    // Whether a reader has reset the change ring since the last snapshot, and is waiting for a fresh one.
+    static bool
+    is_resync_pending(Worker* worker, uint64_t published_epoch) {
+        return worker->diff != nullptr && worker->diff->epoch.load(std::memory_order_relaxed) != published_epoch;
+    }
+
+    // Advance the worker's engine until step `limit`, or by at most `max_changes` changes (events for Gillespie), and
+    // return the step reached. An engine that can change nothing any more jumps to `limit`, or ends a run to consensus.
+    static uint64_t
+    advance_engine(Worker* worker, uint64_t limit, uint64_t max_changes) {
+        if (worker->clock != nullptr) {
+            gillespie::Engine* clock = worker->clock;
+            uint64_t events = std::min(limit, clock->events + max_changes);
+            gillespie::advance(clock, events, INFINITY, worker->diff, worker->gen);
+            if (! (gillespie::total_rate(clock) > 0.)) worker->finished.store(true, std::memory_order_relaxed);
+            return clock->events;
+        }
+        active_links::Engine* engine = worker->engine;
+        active_links::advance(engine, limit, max_changes, worker->diff, worker->gen);
+        if (active_links::num_active(engine) == 0) {
+            if (worker->scenario->steps == 0) worker->finished.store(true, std::memory_order_relaxed);
+            else engine->steps = limit;
+        }
+        return engine->steps;
+    }
+
+    static void
+    run(Worker* worker) {
+        typedef std::chrono::steady_clock clock;
+        graph::Graph* graph = worker->graph;
+        io::Scenario* scenario = worker->scenario;
+
+        // stepping is finished-checked every n / 64 steps, as in opinion-sim
+        uint64_t check_interval = graph->nodes.size() / 64;
+        if (check_interval == 0) check_interval = 1;
+        if (check_interval > WORKER_MAX_BATCH) check_interval = WORKER_MAX_BATCH;
+
+        uint64_t steps = worker->steps.load(std::memory_order_relaxed);
+        // rate limiting counts steps from (base_time, base_steps), reset whenever the rate changes or stepping resumes
+        double current_rate = -1.;
+        auto base_time = clock::now();
+        uint64_t base_steps = steps;
+        auto last_publish = base_time;
+        uint64_t published_epoch = 0;
+        bool dirty = false;
+
+        while (! worker->quit.load(std::memory_order_acquire)) {
+            auto now = clock::now();
+            if (worker->paused.load(std::memory_order_relaxed) || worker->finished.load(std::memory_order_relaxed)) {
+                if (dirty || is_resync_pending(worker, published_epoch)) {
+                    published_epoch = publish(worker);
+                    dirty = false;
+                }
+                current_rate = -1.;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                continue;
+            }
+
+            double rate = worker->rate.load(std::memory_order_relaxed);
+            if (rate != current_rate) {
+                current_rate = rate;
+                base_time = now;
+                base_steps = steps;
+            }
+
+            // how far to step this round
+            uint64_t target = steps + check_interval;
+            if (rate > 0.) {
+                double elapsed = std::chrono::duration<double>(now - base_time).count();
+                uint64_t due = base_steps + (uint64_t) (rate * elapsed);
+                if (due <= steps) {
+                    // sleep until the next step is due, but keep polling the control flags
+                    double wait = ((double) (steps + 1 - base_steps) / rate) - elapsed;
+                    std::this_thread::sleep_for(std::chrono::duration<double>(wait < 0.002 ? wait : 0.002));
+                    continue;
+                }
+                if (due < target) target = due;
+            }
+
+            if (worker->engine != nullptr || worker->clock != nullptr) {
+                // the engines skip steps: unthrottled they may go further than a batch of steps (but not further
+                // than a batch of changes), and they stop where outputs are due so those can be written
+                uint64_t limit = std::min((rate > 0.) ? target : UINT64_MAX, io::next_output_step(scenario, steps));
+                if (scenario->steps > 0) limit = std::min(limit, scenario->steps);
+                steps = advance_engine(worker, limit, check_interval);
+                io::write_outputs(scenario, graph, steps, false);
+            } else {
+                while (steps < target) {
+                    io::step(scenario, graph, worker->diff, worker->gen);
+                    io::write_outputs(scenario, graph, ++steps, false);
+                }
+            }
+            worker->steps.store(steps, std::memory_order_relaxed);
+            if (io::is_finished(scenario, graph, steps)) {
+                worker->finished.store(true, std::memory_order_relaxed);
+            }
+            dirty = true;
+
+            now = clock::now();
+            if (rate > 0. || std::chrono::duration<double>(now - last_publish).count() >= 1. / WORKER_PUBLISH_HZ) {
+                published_epoch = publish(worker);
+                dirty = false;
+                last_publish = now;
+            }
+        }
+        if (dirty) publish(worker);
+    }
+
+    // Start stepping `scenario` on `graph` on a new thread, at `rate` steps per second (0 for as fast as possible).
+    // If `diff` is given, the worker is its only producer. The first snapshot, of the initial state, is available
+    // immediately; changes in `diff` are relative to it.
+    Worker*
+    start(graph::Graph* graph, io::Scenario* scenario, double rate = 0., bool paused = false, Diff* diff = nullptr) {
+        Worker* worker = new Worker;
+        assert(worker);
+        worker->graph = graph;
+        worker->scenario = scenario;
+        worker->diff = diff;
+        worker->gen = rng::stream(rng::master_seed(), RNG_STREAM_WORKER);
+        worker->engine = io::make_engine(scenario, graph);
+        worker->clock = io::make_clock(scenario, graph);
+        if (scenario->sampler == io::SAMPLER_GILLESPIE && worker->clock == nullptr) {
+            fprintf(stderr, "(io) Falling back to edge sampling\n");
+        }
+        worker->quit.store(false);
+        worker->paused.store(paused);
+        worker->rate.store(rate);
+        worker->steps.store(0);
+        worker->finished.store(io::is_finished(scenario, graph, 0));
+
+        triple_buffer::init(&worker->snapshots);
+        publish(worker);
+        triple_buffer::acquire(&worker->snapshots);
+
+        worker->thread = std::thread(run, worker);
+        return worker;
+    }
+
+    // Stop the worker thread and free it. The graph is left as of the last step taken.
+    void
+    stop(Worker* worker) {
+        worker->quit.store(true, std::memory_order_release);
+        worker->thread.join();
+        if (worker->engine != nullptr) active_links::destroy(worker->engine);
+        if (worker->clock != nullptr) gillespie::destroy(worker->clock);
+        delete worker;
+    }
+
+    void
+    set_paused(Worker* worker, bool paused) {
+        worker->paused.store(paused, std::memory_order_relaxed);
+    }
+
+    // Set the stepping rate in steps per second, 0 for as fast as possible.
+    void
+    set_rate(Worker* worker, double rate) {
+        worker->rate.store(rate, std::memory_order_relaxed);
+    }
+
+    // The newest published snapshot. Only one thread may call this; the result stays valid until its next call.
+    const Snapshot*
+    latest(Worker* worker) {
+        triple_buffer::acquire(&worker->snapshots);
+        return triple_buffer::readable(&worker->snapshots);
+    }
+
+    // Start following a worker that was given a change ring. The copy starts from the newest snapshot and is brought
+    // in line with the change stream by the first call to follow.
+    void
+    init_follower(Worker* worker, Follower* follower) {
+        assert( worker->diff != nullptr );
+        follower->opinion = latest(worker)->opinion;
+        follower->epoch = worker->diff->epoch.load(std::memory_order_acquire);
+        follower->resyncing = true;
+    }
+
+    // Bring the follower's copy up to date with the worker. Changes applied one by one are reported through
+    // on_change(const OpinionChange&). Returns true instead if the copy was replaced wholesale from a snapshot (after
+    // the ring overflowed, or on the first call), in which case callers should refresh everything.
+    // Must be called from the thread that calls latest.
+    template <typename F>
+    bool
+    follow(Worker* worker, Follower* follower, F on_change) {
+        Diff* diff = worker->diff;
+        if (ring_buffer::overflowed(diff)) {
+            // changes were lost: start a new epoch and wait for a snapshot that covers them
+            follower->epoch = ring_buffer::reset(diff);
+            follower->resyncing = true;
+        }
+
+        if (follower->resyncing) {
+            const Snapshot* snapshot = latest(worker);
+            if (snapshot->diff_epoch != follower->epoch) return false;
+            follower->opinion = snapshot->opinion;
+            follower->resyncing = false;
+            // changes before the snapshot's position are already in it
+            ring_buffer::drain_from(diff, snapshot->diff_position, [&](const OpinionChange& change) {
+                apply_change(&follower->opinion, change);
+            });
+            return true;
+        }
+
+        ring_buffer::drain(diff, [&](const OpinionChange& change) {
+            apply_change(&follower->opinion, change);
+            on_change(change);
+        });
+        return false;
+    }
+
+} // end namespace
+
+
+#endif
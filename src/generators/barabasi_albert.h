@@ -0,0 +1,79 @@
+/*
+Barabási–Albert scale-free graphs by linear preferential attachment, in O(n m) time.
+
+Preferential attachment is sampled with a repeated-endpoint array: every endpoint of every edge added so far is
+appended to one flat array, so a uniform index into it picks a node with probability proportional to its degree in
+O(1), with no scans over the degree distribution.
+*/
+#ifndef BARABASI_ALBERT_H
+#define BARABASI_ALBERT_H
+
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/graph.h"  // graph::
+#include "../data_structures/builder.h"  // graph::build
+
+namespace generators {
+
+    // Edges of a Barabási–Albert graph on n nodes where each new node attaches to m distinct existing nodes.
+    // The first m nodes start without edges and node m attaches to all of them (as in networkx), so there are
+    // exactly m (n - m) undirected edges, each listed once as (new node, target).
+    template <typename URBG>
+    std::vector<graph::edge_t>
+    barabasi_albert_edges(uint n, uint m, URBG& gen) {
+        assert( m >= 1 && m < n );
+
+        std::vector<graph::edge_t> edges;
+        edges.reserve((size_t) m * (n - m));
+
+        // both endpoints of every edge so far; a uniform pick is a degree-proportional pick
+        std::vector<uint> endpoints;
+        endpoints.reserve(2 * (size_t) m * (n - m));
+
+        std::vector<uint> targets(m);
+        for (uint i = 0; i < m; ++i) {
+            targets[i] = i;
+        }
+
+        for (uint source = m; source < n; ++source) {
+            for (uint target : targets) {
+                edges.push_back(std::make_pair(source, target));
+                endpoints.push_back(target);
+                endpoints.push_back(source);
+            }
+
+            // choose the next node's m distinct targets; m is small, so rejection against the picks so far is cheap
+            std::uniform_int_distribution<size_t> dist(0, endpoints.size() - 1);
+            for (uint i = 0; i < m; ++i) {
+                uint target;
+                do {
+                    target = endpoints[ dist(gen) ];
+                } while (std::find(targets.begin(), targets.begin() + i, target) != targets.begin() + i);
+                targets[i] = target;
+            }
+        }
+        return edges;
+    }
+
+    // Create a Barabási–Albert graph. Edges are stored in both directions.
+    template <typename URBG = decltype(rng::generator)>
+    graph::Graph*
+    barabasi_albert(
+        uint n, uint m,
+        graph::allocation alloc = graph::ALLOC_MALLOC, URBG& gen = rng::generator
+    ) {
+        auto edges = barabasi_albert_edges(n, m, gen);
+        return graph::build(n, edges, true, alloc);
+    }
+
+} // end namespace
+
+
+#endif
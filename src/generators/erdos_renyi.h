@@ -0,0 +1,157 @@
+/*
+Erdős–Rényi random graphs, G(n, p) and G(n, m), in O(n + m) time.
+
+G(n, p) uses geometric skipping (Batagelj & Brandes, 2005): rather than flipping a coin for every candidate pair,
+draw the gap to the next edge from a geometric distribution. G(n, m) draws m distinct pair indices by sampling in
+bulk and deduplicating with sort + unique. Both hand their edge lists straight to graph::build.
+*/
+#ifndef ERDOS_RENYI_H
+#define ERDOS_RENYI_H
+
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/graph.h"  // graph::
+#include "../data_structures/builder.h"  // graph::build
+
+namespace generators {
+
+    // Number of candidate pairs: ordered pairs without self-loops if directed, unordered pairs otherwise.
+    inline uint64_t
+    num_pairs(uint n, bool directed) {
+        uint64_t pairs = (uint64_t) n * (n > 0 ? n - 1 : 0);
+        return directed ? pairs : pairs / 2;
+    }
+
+    // Map a pair index in [0, num_pairs(n, directed)) to an edge.
+    // Directed pairs are enumerated row-major skipping the diagonal; undirected pairs as (v, w) with w < v.
+    inline graph::edge_t
+    pair_at(uint64_t idx, uint n, bool directed) {
+        if (directed) {
+            uint u = (uint) (idx / (n - 1));
+            uint k = (uint) (idx % (n - 1));
+            return std::make_pair( u, (k < u) ? k : k + 1 );
+        }
+        // row v holds pairs (v, 0) ... (v, v - 1) and starts at v (v - 1) / 2
+        uint v = (uint) ((1. + sqrt(1. + 8. * (double) idx)) / 2.);
+        while ((uint64_t) v * (v - 1) / 2 > idx) --v;
+        while ((uint64_t) (v + 1) * v / 2 <= idx) ++v;
+        return std::make_pair( v, (uint) (idx - (uint64_t) v * (v - 1) / 2) );
+    }
+
+    // Call emit(idx) for each index in [0, num_pairs) independently with probability p, in increasing order.
+    // Each draw skips geometrically over the indices that are not picked, so the cost is O(1 + p num_pairs).
+    template <typename URBG, typename F>
+    void
+    sample_pairs(uint64_t num_pairs, double p, URBG& gen, F emit) {
+        if (p <= 0. || num_pairs == 0) return;
+        if (p >= 1.) {
+            for (uint64_t idx = 0; idx < num_pairs; ++idx) {
+                emit(idx);
+            }
+            return;
+        }
+
+        std::uniform_real_distribution<double> dist(0., 1.);
+        double log_q = log(1. - p);
+        // idx is the next candidate index; each draw skips over the ones that are absent
+        uint64_t idx = 0;
+        while (true) {
+            double skip = floor(log(1. - dist(gen)) / log_q);
+            if (skip >= (double) (num_pairs - idx)) break;
+            idx += (uint64_t) skip;
+            emit(idx);
+            if (++idx >= num_pairs) break;
+        }
+    }
+
+    // Edges of a G(n, p) graph: every candidate pair is present independently with probability p.
+    // Undirected graphs list each edge once, as (v, w) with w < v.
+    template <typename URBG>
+    std::vector<graph::edge_t>
+    gnp_edges(uint n, double p, bool directed, URBG& gen) {
+        std::vector<graph::edge_t> edges;
+        uint64_t pairs = num_pairs(n, directed);
+        if (p <= 0. || pairs == 0) return edges;
+
+        edges.reserve((size_t) (p * (double) pairs * 1.05) + 16);
+        sample_pairs(pairs, p, gen, [&](uint64_t idx) {
+            edges.push_back(pair_at(idx, n, directed));
+        });
+        return edges;
+    }
+
+    // Edges of a G(n, m) graph: m distinct candidate pairs chosen uniformly at random.
+    template <typename URBG>
+    std::vector<graph::edge_t>
+    gnm_edges(uint n, uint64_t m, bool directed, URBG& gen) {
+        uint64_t pairs = num_pairs(n, directed);
+        assert( m <= pairs );
+
+        // for dense graphs, sample the (smaller) set of absent pairs instead
+        bool complement = m > pairs / 2;
+        uint64_t target = complement ? pairs - m : m;
+
+        std::vector<uint64_t> chosen;
+        chosen.reserve(target);
+        std::uniform_int_distribution<uint64_t> dist(0, pairs > 0 ? pairs - 1 : 0);
+        while (chosen.size() < target) {
+            for (uint64_t i = chosen.size(); i < target; ++i) {
+                chosen.push_back(dist(gen));
+            }
+            std::sort(chosen.begin(), chosen.end());
+            chosen.erase(std::unique(chosen.begin(), chosen.end()), chosen.end());
+        }
+
+        std::vector<graph::edge_t> edges;
+        edges.reserve(m);
+        if (complement) {
+            auto absent = chosen.begin();
+            for (uint64_t idx = 0; idx < pairs; ++idx) {
+                if (absent != chosen.end() && *absent == idx) {
+                    ++absent;
+                    continue;
+                }
+                edges.push_back(pair_at(idx, n, directed));
+            }
+        } else {
+            for (uint64_t idx : chosen) {
+                edges.push_back(pair_at(idx, n, directed));
+            }
+        }
+        return edges;
+    }
+
+    // Create a G(n, p) graph. Undirected graphs store every edge in both directions.
+    template <typename URBG = decltype(rng::generator)>
+    graph::Graph*
+    erdos_renyi(
+        uint n, double p, bool directed = true,
+        graph::allocation alloc = graph::ALLOC_MALLOC, URBG& gen = rng::generator
+    ) {
+        auto edges = gnp_edges(n, p, directed, gen);
+        return graph::build(n, edges, ! directed, alloc);
+    }
+
+    // Create a G(n, m) graph. Undirected graphs store every edge in both directions, so they have 2m edges.
+    template <typename URBG = decltype(rng::generator)>
+    graph::Graph*
+    erdos_renyi_m(
+        uint n, uint64_t m, bool directed = true,
+        graph::allocation alloc = graph::ALLOC_MALLOC, URBG& gen = rng::generator
+    ) {
+        auto edges = gnm_edges(n, m, directed, gen);
+        return graph::build(n, edges, ! directed, alloc);
+    }
+
+} // end namespace
+
+
+#endif
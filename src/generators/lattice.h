@@ -0,0 +1,123 @@
+/*
+Regular lattices: rings where each node links to its k nearest neighbors on each side, and periodic (or open) grids
+in one to three dimensions.
+
+Degrees are known up front, so nodes are allocated at their final size and adjacency lists are written in place,
+with no per-edge hashing or sorting. Positions follow from the lattice structure.
+*/
+#ifndef LATTICE_H
+#define LATTICE_H
+
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "../types.h"
+#include "../data_structures/graph.h"  // graph::
+#include "../data_structures/builder.h"  // graph::make_with_capacity, graph::list_edges
+#include "layout.h"
+
+namespace generators {
+
+    // Create a ring of n nodes, each linked (in both directions) to its k nearest neighbors on either side.
+    // Requires 2k < n so that no pair is linked twice. Nodes are laid out on a circle.
+    graph::Graph*
+    ring_lattice(uint n, uint k, graph::allocation alloc = graph::ALLOC_MALLOC) {
+        assert( 2 * k < n );
+
+        graph::Graph* graph = graph::make_with_capacity(std::vector<uint>(n, 2 * k), true, alloc);
+        std::vector<uint> offsets(n + 1);
+        for (uint i = 0; i <= n; ++i) {
+            offsets[i] = 2 * k * i;
+        }
+        graph::parallel_for_nodes(offsets, graph::default_num_threads(), [&](uint first, uint last) {
+            for (uint i = first; i < last; ++i) {
+                graph::Node* node = graph->nodes[i];
+                for (uint j = 1; j <= k; ++j) {
+                    node->adjacent[ node->num_adjacent++ ] = (i + n - j) % n;
+                    node->adjacent[ node->num_adjacent++ ] = (i + j) % n;
+                }
+                node->is_sorted = 0;
+            }
+        });
+        graph::list_edges(graph);
+
+        layout_circle(graph, 10.f);
+        return graph;
+    }
+
+    // Create a lattice with the given dimensions (1 to 3 of them, nodes numbered row-major), where every node is
+    // linked in both directions to its nearest neighbor on either side along each axis.
+    // With `periodic`, each axis wraps around (a ring, torus, or 3-torus). Axes shorter than 3 do not produce
+    // duplicate or self links. Nodes are laid out on a grid.
+    graph::Graph*
+    lattice(const std::vector<uint>& dims, bool periodic = true, graph::allocation alloc = graph::ALLOC_MALLOC) {
+        assert( dims.size() >= 1 && dims.size() <= 3 );
+
+        uint n = 1;
+        for (uint d : dims) {
+            assert( d > 0 );
+            n *= d;
+        }
+        uint max_degree = 2 * (uint) dims.size();
+
+        graph::Graph* graph = graph::make_with_capacity(std::vector<uint>(n, max_degree), true, alloc);
+        std::vector<uint> offsets(n + 1);
+        for (uint i = 0; i <= n; ++i) {
+            offsets[i] = max_degree * i;
+        }
+        graph::parallel_for_nodes(offsets, graph::default_num_threads(), [&](uint first, uint last) {
+            uint coords[3];
+            for (uint i = first; i < last; ++i) {
+                // row-major coordinates, first axis fastest
+                uint rest = i;
+                for (uint a = 0; a < dims.size(); ++a) {
+                    coords[a] = rest % dims[a];
+                    rest /= dims[a];
+                }
+
+                graph::Node* node = graph->nodes[i];
+                uint stride = 1;
+                for (uint a = 0; a < dims.size(); ++a) {
+                    uint c = coords[a];
+                    uint d = dims[a];
+                    // neighbor below and above along this axis, if any
+                    bool has_prev = periodic ? d > 1 : c > 0;
+                    bool has_next = periodic ? d > 2 : c + 1 < d;
+                    if (has_prev) {
+                        uint prev = (c + d - 1) % d;
+                        node->adjacent[ node->num_adjacent++ ] = i - c * stride + prev * stride;
+                    }
+                    if (has_next) {
+                        uint next = (c + 1) % d;
+                        node->adjacent[ node->num_adjacent++ ] = i - c * stride + next * stride;
+                    }
+                    stride *= d;
+                }
+                node->is_sorted = 0;
+            }
+        });
+        graph::list_edges(graph);
+
+        layout_grid(graph, dims, 1.f);
+        return graph;
+    }
+
+    // Create a rows x cols periodic (or open) square lattice.
+    graph::Graph*
+    lattice_2d(uint rows, uint cols, bool periodic = true, graph::allocation alloc = graph::ALLOC_MALLOC) {
+        return lattice({ cols, rows }, periodic, alloc);
+    }
+
+    // Create an nx x ny x nz periodic (or open) cubic lattice.
+    graph::Graph*
+    lattice_3d(uint nx, uint ny, uint nz, bool periodic = true, graph::allocation alloc = graph::ALLOC_MALLOC) {
+        return lattice({ nx, ny, nz }, periodic, alloc);
+    }
+
+} // end namespace
+
+
+#endif
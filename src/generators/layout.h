@@ -0,0 +1,69 @@
+/*
+Static node layouts for generated graphs, written into the graph's position columns.
+*/
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+
+#include <math.h>
+#include <vector>
+
+#include "../types.h"
+#include "../data_structures/graph.h"  // graph::
+
+namespace generators {
+
+    // Place nodes evenly around a circle of the given radius, in index order.
+    // Uses a rotation recurrence, so there is one sin/cos pair for the whole graph rather than one per node.
+    void
+    layout_circle(graph::Properties* properties, float radius) {
+        uint num_nodes = (uint) properties->x.size();
+        if (num_nodes == 0) return;
+
+        double step = 2. * 4. * atan(1.) / (double) num_nodes;
+        double c = cos(step), s = sin(step);
+        double x = radius, y = 0.;
+        for (uint n = 0; n < num_nodes; ++n) {
+            properties->x[n] = (float) x;
+            properties->y[n] = (float) y;
+            double rotated_x = c * x - s * y;
+            y = s * x + c * y;
+            x = rotated_x;
+        }
+    }
+
+    // Place nodes of a row-major lattice with the given dimensions (1 to 3 of them) on a grid centered on the origin.
+    // The third dimension is drawn as an oblique offset so that layers do not overlap.
+    void
+    layout_grid(graph::Properties* properties, const std::vector<uint>& dims, float spacing) {
+        uint nx = dims.size() > 0 ? dims[0] : 1;
+        uint ny = dims.size() > 1 ? dims[1] : 1;
+        uint nz = dims.size() > 2 ? dims[2] : 1;
+        float cx = 0.5f * (float) (nx - 1) + 0.25f * (float) (nz - 1);
+        float cy = 0.5f * (float) (ny - 1) + 0.25f * (float) (nz - 1);
+
+        uint n = 0;
+        for (uint z = 0; z < nz; ++z) {
+            for (uint y = 0; y < ny; ++y) {
+                for (uint x = 0; x < nx; ++x, ++n) {
+                    properties->x[n] = spacing * ((float) x + 0.5f * (float) z - cx);
+                    properties->y[n] = spacing * ((float) y + 0.5f * (float) z - cy);
+                }
+            }
+        }
+    }
+
+    void
+    layout_circle(graph::Graph* graph, float radius) {
+        layout_circle(&graph->properties, radius);
+    }
+
+    void
+    layout_grid(graph::Graph* graph, const std::vector<uint>& dims, float spacing) {
+        layout_grid(&graph->properties, dims, spacing);
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,114 @@
+/*
+Stochastic block model: nodes are split into blocks (communities), and each pair of nodes is linked independently
+with a probability that depends only on their two blocks.
+
+Every block pair is sampled with geometric skipping (see erdos_renyi.h), so the total cost is O(n + m + B^2) for B
+blocks. Block membership is recorded in the graph's `block` property column.
+*/
+#ifndef STOCHASTIC_BLOCK_MODEL_H
+#define STOCHASTIC_BLOCK_MODEL_H
+
+
+#include <assert.h>
+#include <stdint.h>
+#include <random>
+#include <vector>
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/graph.h"  // graph::
+#include "../data_structures/builder.h"  // graph::build
+#include "erdos_renyi.h"  // generators::sample_pairs, generators::pair_at
+
+namespace generators {
+
+    // Edges of a stochastic block model. Nodes are numbered block by block: block b holds sizes[b] consecutive nodes.
+    // probs[r][s] is the probability of an edge between a node of block r and a node of block s.
+    // Undirected models read only the upper triangle (r <= s) and list each edge once; directed models read the whole
+    // matrix and have no self-loops.
+    template <typename URBG>
+    std::vector<graph::edge_t>
+    sbm_edges(
+        const std::vector<uint>& sizes, const std::vector<std::vector<double>>& probs,
+        bool directed, URBG& gen
+    ) {
+        uint num_blocks = (uint) sizes.size();
+        assert( probs.size() == num_blocks );
+
+        std::vector<uint> offsets(num_blocks + 1, 0);
+        for (uint b = 0; b < num_blocks; ++b) {
+            offsets[b + 1] = offsets[b] + sizes[b];
+        }
+
+        std::vector<graph::edge_t> edges;
+        for (uint r = 0; r < num_blocks; ++r) {
+            assert( probs[r].size() == num_blocks );
+            for (uint s = directed ? 0 : r; s < num_blocks; ++s) {
+                double p = probs[r][s];
+                if (r == s) {
+                    // within a block: same enumeration as G(n, p), shifted to the block's first node
+                    uint offset = offsets[r];
+                    sample_pairs(num_pairs(sizes[r], directed), p, gen, [&](uint64_t idx) {
+                        graph::edge_t edge = pair_at(idx, sizes[r], directed);
+                        edges.push_back(std::make_pair(offset + edge.first, offset + edge.second));
+                    });
+                } else {
+                    // between blocks: every (node of r, node of s) pair, row-major
+                    uint cols = sizes[s];
+                    sample_pairs((uint64_t) sizes[r] * cols, p, gen, [&](uint64_t idx) {
+                        edges.push_back(std::make_pair(
+                            offsets[r] + (uint) (idx / cols),
+                            offsets[s] + (uint) (idx % cols)));
+                    });
+                }
+            }
+        }
+        return edges;
+    }
+
+    // Create a stochastic block model graph and record each node's block in `properties.block`.
+    // Undirected graphs store every edge in both directions.
+    template <typename URBG = decltype(rng::generator)>
+    graph::Graph*
+    stochastic_block_model(
+        const std::vector<uint>& sizes, const std::vector<std::vector<double>>& probs, bool directed = false,
+        graph::allocation alloc = graph::ALLOC_MALLOC, URBG& gen = rng::generator
+    ) {
+        uint n = 0;
+        for (uint size : sizes) {
+            n += size;
+        }
+
+        auto edges = sbm_edges(sizes, probs, directed, gen);
+        graph::Graph* graph = graph::build(n, edges, ! directed, alloc);
+
+        graph->properties.block.resize(n);
+        uint node = 0;
+        for (uint b = 0; b < sizes.size(); ++b) {
+            for (uint i = 0; i < sizes[b]; ++i) {
+                graph->properties.block[node++] = b;
+            }
+        }
+        return graph;
+    }
+
+    // Create a planted-partition model: `num_blocks` blocks of `block_size` nodes, with probability p_in within
+    // blocks and p_out between them.
+    template <typename URBG = decltype(rng::generator)>
+    graph::Graph*
+    planted_partition(
+        uint num_blocks, uint block_size, double p_in, double p_out, bool directed = false,
+        graph::allocation alloc = graph::ALLOC_MALLOC, URBG& gen = rng::generator
+    ) {
+        std::vector<uint> sizes(num_blocks, block_size);
+        std::vector<std::vector<double>> probs(num_blocks, std::vector<double>(num_blocks, p_out));
+        for (uint b = 0; b < num_blocks; ++b) {
+            probs[b][b] = p_in;
+        }
+        return stochastic_block_model(sizes, probs, directed, alloc, gen);
+    }
+
+} // end namespace
+
+
+#endif
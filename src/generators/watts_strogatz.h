@@ -0,0 +1,127 @@
+/*
+Watts–Strogatz small-world graphs: a ring lattice whose edges are each rewired to a random far endpoint with
+probability beta.
+
+Rewired edges are picked by geometric skipping, so the random work is O(beta n k). Degrees follow from the rewiring
+decisions, so nodes are allocated at their final size and adjacency lists are written in place in one pass.
+*/
+#ifndef WATTS_STROGATZ_H
+#define WATTS_STROGATZ_H
+
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/graph.h"  // graph::
+#include "../data_structures/builder.h"  // graph::make_with_capacity, graph::list_edges
+#include "layout.h"
+
+// Random draws for a rewired endpoint before falling back to listing the remaining candidates.
+#define WATTS_STROGATZ_MAX_ATTEMPTS 64
+
+namespace generators {
+
+    // Create a Watts–Strogatz graph on n nodes: start from a ring where each node links to its k nearest neighbors on
+    // either side, then replace each lattice edge (i, i + j) with (i, w) with probability beta, where w is uniform
+    // over the nodes that are neither i, within lattice distance k of i, nor already rewired to i. An edge whose node i
+    // has no such node left (only possible when 2k is close to n) stays on the lattice.
+    // The graph keeps exactly n k undirected edges, stored in both directions. Nodes are laid out on a circle.
+    template <typename URBG = decltype(rng::generator)>
+    graph::Graph*
+    watts_strogatz(
+        uint n, uint k, double beta,
+        graph::allocation alloc = graph::ALLOC_MALLOC, URBG& gen = rng::generator
+    ) {
+        assert( 2 * k < n );
+        assert( beta <= 0. || n > 2 * k + 1 );
+
+        // target[i k + j - 1] is the far endpoint of node i's j-th forward lattice edge
+        uint64_t num_edges = (uint64_t) n * k;
+        std::vector<uint> target(num_edges);
+        for (uint64_t e = 0; e < num_edges; ++e) {
+            target[e] = (uint) ((e / k + e % k + 1) % n);
+        }
+
+        // rewire, skipping geometrically over the edges that stay put
+        if (beta > 0.) {
+            std::uniform_real_distribution<double> coin(0., 1.);
+            std::uniform_int_distribution<uint> node(0, n - 1);
+            std::unordered_set<uint64_t> rewired;
+            // far endpoints each node could still be rewired to
+            std::vector<uint> far_left(n, n - 2 * k - 1);
+            double log_q = log(1. - beta);
+            uint64_t e = 0;
+            while (e < num_edges) {
+                if (beta < 1.) {
+                    double skip = floor(log(1. - coin(gen)) / log_q);
+                    if (skip >= (double) (num_edges - e)) break;
+                    e += (uint64_t) skip;
+                }
+
+                uint i = (uint) (e / k);
+                if (far_left[i] == 0) {
+                    ++e;
+                    continue;
+                }
+                auto key = [i](uint w) { return ((uint64_t) std::min(i, w) << 32) | std::max(i, w); };
+                auto is_far = [i, n, k](uint w) {
+                    uint dist = (w > i) ? w - i : i - w;
+                    return std::min(dist, n - dist) > k;  // not self or a lattice neighbor
+                };
+                uint w = graph::NIL;
+                for (uint attempt = 0; attempt < WATTS_STROGATZ_MAX_ATTEMPTS; ++attempt) {
+                    uint candidate = node(gen);
+                    if (is_far(candidate) && rewired.count(key(candidate)) == 0) {
+                        w = candidate;
+                        break;
+                    }
+                }
+                if (w == graph::NIL) {
+                    // few candidates left: pick uniformly among them directly
+                    std::vector<uint> candidates;
+                    for (uint v = 0; v < n; ++v) {
+                        if (is_far(v) && rewired.count(key(v)) == 0) candidates.push_back(v);
+                    }
+                    assert( candidates.size() == far_left[i] );
+                    w = candidates[ std::uniform_int_distribution<size_t>(0, candidates.size() - 1)(gen) ];
+                }
+                rewired.insert(key(w));
+                far_left[i]--;
+                far_left[w]--;
+                target[e] = w;
+                ++e;
+            }
+        }
+
+        // allocate at final degree and fill both directions of every edge
+        std::vector<uint> degrees(n, k);
+        for (uint w : target) {
+            degrees[w]++;
+        }
+        graph::Graph* graph = graph::make_with_capacity(degrees, true, alloc);
+        for (uint64_t e = 0; e < num_edges; ++e) {
+            uint i = (uint) (e / k);
+            graph::Node* source = graph->nodes[i];
+            graph::Node* dest = graph->nodes[ target[e] ];
+            source->adjacent[ source->num_adjacent++ ] = target[e];
+            dest->adjacent[ dest->num_adjacent++ ] = i;
+        }
+        for (graph::Node* node : graph->nodes) {
+            node->is_sorted = 0;
+        }
+        graph::list_edges(graph);
+
+        layout_circle(graph, 10.f);
+        return graph;
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,266 @@
+/*
+Versioned binary on-disk format for graphs, laid out so that a saved graph can be opened with mmap and used in place.
+
+    header              fixed-size, see io::header
+    offsets             (num_nodes + 1) x uint32, CSR offsets
+    neighbors           num_edges x uint32, CSR neighbors, sorted within each run
+    x, y                num_nodes x float32 each
+    opinion             ceil(num_nodes / 64) x uint64, packed bitset words
+    block               num_nodes x uint32, only if BINARY_HAS_BLOCK is set
+
+Every section starts on a BINARY_ALIGNMENT boundary. Values are stored in the writer's native byte order, which is
+recorded in the header and checked on load.
+
+io::load_csr maps the file and points the CSR topology straight into the mapping, so opening is O(num_nodes) for the
+property columns and independent of the number of edges. Processes that open the same file share its pages.
+*/
+#ifndef BINARY_H
+#define BINARY_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#include "../types.h"
+#include "../data_structures/graph.h"
+#include "../data_structures/csr.h"
+#include "../data_structures/builder.h"  // graph::thaw
+#include "mmap.h"
+
+#define BINARY_MAGIC "ODGRAPH"  // 8 bytes with the terminator
+#define BINARY_VERSION (1)
+#define BINARY_BYTE_ORDER (0x01020304u)
+#define BINARY_ALIGNMENT (64)
+
+// header flags
+#define BINARY_UNDIRECTED (1u << 0)
+#define BINARY_HAS_BLOCK (1u << 1)
+
+namespace io {
+    //// Types
+    typedef struct header Header;
+
+    //// forward declarations
+    // structs
+    struct header;
+
+    // functions
+    bool save(const graph::CSR*, const char*);
+    bool save(const graph::Graph*, const char*);
+    graph::CSR* load_csr(const char*);
+    graph::Graph* load(const char*, graph::allocation);
+
+
+    //// Implementations
+    struct header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t flags;
+        uint32_t num_nodes;
+        uint32_t num_edges;
+        uint32_t reserved;
+        uint64_t file_size;
+
+        // byte offset of each section from the start of the file, 0 if absent
+        uint64_t offsets;
+        uint64_t neighbors;
+        uint64_t x;
+        uint64_t y;
+        uint64_t opinion;
+        uint64_t block;
+    };
+    static_assert( sizeof(Header) == 88, "binary header layout changed" );
+
+    static inline uint64_t
+    align_up(uint64_t bytes) {
+        return (bytes + BINARY_ALIGNMENT - 1) & ~((uint64_t) BINARY_ALIGNMENT - 1);
+    }
+
+    // Write `bytes` bytes at `data` to `fp`, preceded by zero padding up to the next section boundary.
+    // `position` tracks the current offset into the file.
+    static bool
+    write_section(FILE* fp, uint64_t* position, const void* data, uint64_t bytes) {
+        static const char padding[BINARY_ALIGNMENT] = { 0 };
+        uint64_t start = align_up(*position);
+        if (start > *position && fwrite(padding, 1, (size_t) (start - *position), fp) != start - *position) return false;
+        if (bytes > 0 && fwrite(data, 1, (size_t) bytes, fp) != bytes) return false;
+        *position = start + bytes;
+        return true;
+    }
+
+    // Save a frozen graph to `path` in one pass. Returns false (and reports why on stderr) on failure.
+    bool
+    save(const graph::CSR* csr, const char* path) {
+        const graph::Properties& properties = csr->properties;
+        bool has_block = ! properties.block.empty();
+        assert( properties.x.size() == csr->num_nodes && properties.y.size() == csr->num_nodes );
+        assert( properties.opinion.size == csr->num_nodes );
+        assert( ! has_block || properties.block.size() == csr->num_nodes );
+
+        // lay out the sections
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+        header.version = BINARY_VERSION;
+        header.byte_order = BINARY_BYTE_ORDER;
+        header.flags = (csr->is_undirected ? BINARY_UNDIRECTED : 0) | (has_block ? BINARY_HAS_BLOCK : 0);
+        header.num_nodes = csr->num_nodes;
+        header.num_edges = csr->num_edges;
+
+        uint64_t offsets_bytes = sizeof(uint32_t) * ((uint64_t) csr->num_nodes + 1);
+        uint64_t neighbors_bytes = sizeof(uint32_t) * (uint64_t) csr->num_edges;
+        uint64_t column_bytes = sizeof(float) * (uint64_t) csr->num_nodes;
+        uint64_t opinion_bytes = sizeof(uint64_t) * (uint64_t) properties.opinion.words.size();
+        uint64_t block_bytes = has_block ? sizeof(uint32_t) * (uint64_t) csr->num_nodes : 0;
+
+        header.offsets = align_up(sizeof(Header));
+        header.neighbors = align_up(header.offsets + offsets_bytes);
+        header.x = align_up(header.neighbors + neighbors_bytes);
+        header.y = align_up(header.x + column_bytes);
+        header.opinion = align_up(header.y + column_bytes);
+        header.block = has_block ? align_up(header.opinion + opinion_bytes) : 0;
+        header.file_size = has_block ? header.block + block_bytes : header.opinion + opinion_bytes;
+
+        FILE* fp = fopen(path, "wb");
+        if (! fp) {
+            fprintf(stderr, "(io) Could not open %s for writing\n", path);
+            return false;
+        }
+
+        uint64_t position = 0;
+        bool ok = write_section(fp, &position, &header, sizeof(header))
+            && write_section(fp, &position, csr->offsets, offsets_bytes)
+            && write_section(fp, &position, csr->neighbors, neighbors_bytes)
+            && write_section(fp, &position, properties.x.data(), column_bytes)
+            && write_section(fp, &position, properties.y.data(), column_bytes)
+            && write_section(fp, &position, properties.opinion.words.data(), opinion_bytes)
+            && (! has_block || write_section(fp, &position, properties.block.data(), block_bytes));
+        assert( ! ok || position == header.file_size );
+
+        if (fclose(fp) != 0) ok = false;
+        if (! ok) {
+            fprintf(stderr, "(io) Error writing %s\n", path);
+        }
+        return ok;
+    }
+
+    // Save a graph to `path`. Adjacency lists are written sorted, as in its frozen form.
+    bool
+    save(const graph::Graph* graph, const char* path) {
+        graph::CSR* csr = graph::freeze(graph);
+        bool ok = save(csr, path);
+        graph::destroy(csr);
+        return ok;
+    }
+
+    // Check that a mapped file holds a graph this build can read in place.
+    static bool
+    validate(const Mapping* mapping, const char* path) {
+        if (mapping->size < sizeof(Header)) {
+            fprintf(stderr, "(io) %s is too small to be a graph file\n", path);
+            return false;
+        }
+        const Header* header = (const Header*) mapping->data;
+        if (memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic)) != 0) {
+            fprintf(stderr, "(io) %s is not a graph file\n", path);
+            return false;
+        }
+        if (header->version != BINARY_VERSION) {
+            fprintf(stderr, "(io) %s has format version %u, expected %u\n", path, header->version, BINARY_VERSION);
+            return false;
+        }
+        if (header->byte_order != BINARY_BYTE_ORDER) {
+            fprintf(stderr, "(io) %s was written with a different byte order\n", path);
+            return false;
+        }
+        if (header->file_size > mapping->size) {
+            fprintf(stderr, "(io) %s is truncated\n", path);
+            return false;
+        }
+
+        // every section must lie inside the file
+        uint64_t n = header->num_nodes;
+        uint64_t sections[][2] = {
+            { header->offsets, sizeof(uint32_t) * (n + 1) },
+            { header->neighbors, sizeof(uint32_t) * (uint64_t) header->num_edges },
+            { header->x, sizeof(float) * n },
+            { header->y, sizeof(float) * n },
+            { header->opinion, sizeof(uint64_t) * (uint64_t) bitset::num_words(n) },
+            { header->block, (header->flags & BINARY_HAS_BLOCK) ? sizeof(uint32_t) * n : 0 },
+        };
+        for (auto& section : sections) {
+            if (section[1] > 0 && (section[0] % BINARY_ALIGNMENT != 0 || section[0] + section[1] > header->file_size)) {
+                fprintf(stderr, "(io) %s has a corrupt section table\n", path);
+                return false;
+            }
+        }
+
+        const uint32_t* offsets = (const uint32_t*) (mapping->data + header->offsets);
+        if (offsets[0] != 0 || offsets[n] != header->num_edges) {
+            fprintf(stderr, "(io) %s has inconsistent offsets\n", path);
+            return false;
+        }
+        return true;
+    }
+
+    // Open a graph saved with io::save without parsing or copying its topology: the CSR offsets and neighbors point
+    // into a shared, read-only mapping of the file, which is released by graph::destroy. Property columns are copied
+    // so that opinions can be changed freely. Returns nullptr (and reports why on stderr) on failure.
+    // NOTE: beyond the header and offsets, the file's contents are trusted.
+    graph::CSR*
+    load_csr(const char* path) {
+        Mapping* mapping = map_file(path);
+        if (mapping == nullptr) return nullptr;
+        if (! validate(mapping, path)) {
+            unmap(mapping);
+            return nullptr;
+        }
+
+        const Header* header = (const Header*) mapping->data;
+        uint n = header->num_nodes;
+
+        graph::CSR* csr = new graph::CSR;
+        assert(csr);
+        csr->num_nodes = n;
+        csr->num_edges = header->num_edges;
+        csr->is_undirected = (header->flags & BINARY_UNDIRECTED) != 0;
+        csr->offsets = (const uint*) (mapping->data + header->offsets);
+        csr->neighbors = (const uint*) (mapping->data + header->neighbors);
+        csr->backing = mapping;
+        csr->release_backing = release_mapping;
+
+        graph::Properties& properties = csr->properties;
+        const float* x = (const float*) (mapping->data + header->x);
+        const float* y = (const float*) (mapping->data + header->y);
+        properties.x.assign(x, x + n);
+        properties.y.assign(y, y + n);
+        bitset::resize(&properties.opinion, n);
+        const uint64_t* words = (const uint64_t*) (mapping->data + header->opinion);
+        std::copy(words, words + properties.opinion.words.size(), properties.opinion.words.begin());
+        if (header->flags & BINARY_HAS_BLOCK) {
+            const uint32_t* block = (const uint32_t*) (mapping->data + header->block);
+            properties.block.assign(block, block + n);
+        }
+
+        return csr;
+    }
+
+    // Load a graph saved with io::save as a mutable graph::Graph. Returns nullptr on failure.
+    graph::Graph*
+    load(const char* path, graph::allocation alloc = graph::ALLOC_MALLOC) {
+        graph::CSR* csr = load_csr(path);
+        if (csr == nullptr) return nullptr;
+        graph::Graph* graph = graph::thaw(csr, alloc);
+        graph::destroy(csr);
+        return graph;
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,348 @@
+/*
+Importer for whitespace-separated edge lists, e.g. the SNAP dataset format:
+
+    # comment
+    0	1
+    0	7
+    ...
+
+The file is memory-mapped and split at line boundaries into one chunk per thread. Each chunk is parsed with a
+hand-rolled integer scanner into its own buffer of raw (source, dest) ids. External ids may be sparse 64-bit
+integers; they are remapped to dense node indices in increasing id order, either through a presence bitmap (when the
+id range is not much larger than the edge count) or through a sorted table of the distinct ids, which each thread
+collects from its chunk in a hash set sized by the number of distinct ids rather than the number of edges. The
+remapped edges are packed in place into the raw buffers and streamed into graph::build, so peak memory stays at a
+small constant number of bytes per edge.
+
+Lines starting with '#' or '%' are comments. Anything after the second integer of a line (weights, timestamps) is
+ignored. Fields may be separated by spaces, tabs or commas, and CRLF line endings are accepted.
+*/
+#ifndef EDGE_LIST_H
+#define EDGE_LIST_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../types.h"
+#include "../data_structures/graph.h"
+#include "../data_structures/bitset.h"  // bitset::popcount, bitset::ctz
+#include "../data_structures/builder.h"  // graph::build, graph::default_num_threads
+#include "mmap.h"
+
+// Use the presence bitmap for id remapping while max id < EDGE_LIST_BITMAP_RATIO * number of edges.
+// At 128 the bitmap costs at most as much memory as the raw ids themselves (16 bytes per edge).
+#define EDGE_LIST_BITMAP_RATIO (128)
+
+namespace io {
+
+    // Raw ids parsed from one chunk of the file, as source, dest, source, dest, ...
+    // After remapping, the first half holds packed dense edges (source << 32 | dest).
+    struct edge_chunk {
+        const char* begin;
+        const char* end;
+        std::vector<uint64_t> ids;
+        size_t num_edges;
+        uint64_t max_id;
+        size_t num_malformed;
+    };
+
+    static inline bool
+    is_separator(char c) {
+        return c == ' ' || c == '\t' || c == ',' || c == '\r';
+    }
+
+    static inline bool
+    is_digit(char c) {
+        return (unsigned) (c - '0') < 10u;
+    }
+
+    // Parse the lines in [chunk->begin, chunk->end).
+    static void
+    parse_chunk(edge_chunk* chunk) {
+        const char* p = chunk->begin;
+        const char* end = chunk->end;
+        chunk->num_edges = 0;
+        chunk->max_id = 0;
+        chunk->num_malformed = 0;
+        // a rough first guess (about 12 bytes per line) saves most of the regrowth
+        chunk->ids.reserve((size_t) (end - p) / 6);
+
+        while (p < end) {
+            while (p < end && is_separator(*p)) ++p;
+            if (p == end) break;
+            if (*p == '\n') {
+                ++p;
+                continue;
+            }
+
+            bool ok = false;
+            if (*p != '#' && *p != '%' && is_digit(*p)) {
+                uint64_t source = 0;
+                while (p < end && is_digit(*p)) source = source * 10 + (uint64_t) (*p++ - '0');
+                while (p < end && is_separator(*p)) ++p;
+                if (p < end && is_digit(*p)) {
+                    uint64_t dest = 0;
+                    while (p < end && is_digit(*p)) dest = dest * 10 + (uint64_t) (*p++ - '0');
+                    chunk->ids.push_back(source);
+                    chunk->ids.push_back(dest);
+                    chunk->max_id = std::max(chunk->max_id, std::max(source, dest));
+                    chunk->num_edges++;
+                    ok = true;
+                }
+            } else if (*p == '#' || *p == '%') {
+                ok = true;
+            }
+            if (! ok) chunk->num_malformed++;
+
+            // skip the rest of the line
+            while (p < end && *p != '\n') ++p;
+            if (p < end) ++p;
+        }
+    }
+
+    // Run f(t) for t in [0, num_tasks) on one thread each.
+    template <typename F>
+    static void
+    run_tasks(uint num_tasks, F f) {
+        if (num_tasks == 1) {
+            f(0u);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (uint t = 0; t < num_tasks; ++t) {
+            threads.emplace_back(f, t);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // The distinct values in `ids`, sorted. They are collected in an open-addressing hash set that grows with the
+    // number of distinct values, so no copy of `ids` is made.
+    static std::vector<uint64_t>
+    distinct_ids(const std::vector<uint64_t>& ids) {
+        const uint64_t empty = UINT64_MAX;  // marks a free slot; recorded on the side when it is an id itself
+        uint bits = 10;
+        std::vector<uint64_t> table((size_t) 1 << bits, empty);
+        size_t used = 0;
+        bool has_empty = false;
+        auto insert = [&](uint64_t id) {
+            size_t mask = table.size() - 1;
+            size_t i = (size_t) ((id * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+            while (table[i] != empty && table[i] != id) i = (i + 1) & mask;
+            if (table[i] == id) return false;
+            table[i] = id;
+            return true;
+        };
+
+        for (uint64_t id : ids) {
+            if (id == empty) {
+                has_empty = true;
+                continue;
+            }
+            if (! insert(id) || ++used * 2 <= table.size()) continue;
+            // keep the load at most one half
+            std::vector<uint64_t> old((size_t) 1 << ++bits, empty);
+            old.swap(table);
+            for (uint64_t kept : old) {
+                if (kept != empty) insert(kept);
+            }
+        }
+
+        std::vector<uint64_t> distinct;
+        distinct.reserve(used + has_empty);
+        for (uint64_t id : table) {
+            if (id != empty) distinct.push_back(id);
+        }
+        std::vector<uint64_t>().swap(table);
+        std::sort(distinct.begin(), distinct.end());
+        if (has_empty) distinct.push_back(empty);
+        return distinct;
+    }
+
+    // Forward iterator over the packed dense edges of all chunks, dereferencing to graph::edge_t.
+    struct packed_edge_iterator {
+        typedef std::forward_iterator_tag iterator_category;
+        typedef graph::edge_t value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const graph::edge_t* pointer;
+        typedef graph::edge_t reference;
+
+        const std::vector<edge_chunk>* chunks;
+        size_t chunk;
+        size_t index;
+
+        graph::edge_t operator*() const {
+            uint64_t packed = (*chunks)[chunk].ids[index];
+            return std::make_pair((uint) (packed >> 32), (uint) packed);
+        }
+        packed_edge_iterator& operator++() {
+            ++index;
+            skip_exhausted();
+            return *this;
+        }
+        bool operator==(const packed_edge_iterator& other) const {
+            return chunk == other.chunk && index == other.index;
+        }
+        bool operator!=(const packed_edge_iterator& other) const {
+            return ! (*this == other);
+        }
+        // move past chunks with no edges left, stopping at (chunks->size(), 0)
+        void skip_exhausted() {
+            while (chunk < chunks->size() && index >= (*chunks)[chunk].num_edges) {
+                ++chunk;
+                index = 0;
+            }
+        }
+    };
+
+    // Read an edge list from `path` into a new graph. Node n of the graph corresponds to the n-th smallest id that
+    // appears in the file; if `external_ids` is given, it receives those ids. With `undirected`, every edge is added
+    // in both directions. Duplicate edges are dropped.
+    // Returns nullptr (and reports why on stderr) on failure.
+    graph::Graph*
+    read_edge_list(
+        const char* path, bool undirected = false, graph::allocation alloc = graph::ALLOC_MALLOC,
+        std::vector<uint64_t>* external_ids = nullptr, uint num_threads = graph::default_num_threads()
+    ) {
+        Mapping* mapping = map_file(path);
+        if (mapping == nullptr) return nullptr;
+
+        // split at line boundaries
+        const char* data = mapping->data;
+        size_t size = mapping->size;
+        num_threads = std::max(1u, std::min(num_threads, (uint) (size / 4096 + 1)));
+        std::vector<edge_chunk> chunks(num_threads);
+        const char* cursor = data;
+        for (uint t = 0; t < num_threads; ++t) {
+            const char* end = (t + 1 == num_threads) ? data + size : data + size * (t + 1) / num_threads;
+            if (end < cursor) end = cursor;
+            while (end < data + size && end > data && end[-1] != '\n') ++end;
+            chunks[t].begin = cursor;
+            chunks[t].end = end;
+            cursor = end;
+        }
+
+        // parse
+        run_tasks(num_threads, [&](uint t) { parse_chunk(&chunks[t]); });
+
+        size_t num_edges = 0;
+        size_t num_malformed = 0;
+        uint64_t max_id = 0;
+        for (auto& chunk : chunks) {
+            num_edges += chunk.num_edges;
+            num_malformed += chunk.num_malformed;
+            max_id = std::max(max_id, chunk.max_id);
+        }
+        // the text is no longer needed
+        unmap(mapping);
+        if (num_malformed > 0) {
+            fprintf(stderr, "(io) Skipped %zu malformed lines in %s\n", num_malformed, path);
+        }
+
+        // remap ids to dense node indices, ordered by id
+        uint num_nodes = 0;
+        std::vector<uint64_t> distinct;
+        if (num_edges == 0) {
+            // nothing to remap
+        } else if (max_id / EDGE_LIST_BITMAP_RATIO < num_edges) {
+            // mark present ids in a shared bitmap, then rank = number of present ids below
+            size_t num_words = (size_t) (max_id / 64) + 1;
+            std::unique_ptr<std::atomic<uint64_t>[]> present(new std::atomic<uint64_t>[num_words]);
+            for (size_t w = 0; w < num_words; ++w) {
+                present[w].store(0, std::memory_order_relaxed);
+            }
+            run_tasks(num_threads, [&](uint t) {
+                for (uint64_t id : chunks[t].ids) {
+                    present[id / 64].fetch_or((uint64_t) 1 << (id % 64), std::memory_order_relaxed);
+                }
+            });
+
+            std::vector<uint64_t> words(num_words);
+            std::vector<uint64_t> rank(num_words);
+            uint64_t total = 0;
+            for (size_t w = 0; w < num_words; ++w) {
+                words[w] = present[w].load(std::memory_order_relaxed);
+                rank[w] = total;
+                total += bitset::popcount(words[w]);
+            }
+            present.reset();
+            if (total >= graph::NIL) {
+                fprintf(stderr, "(io) %s has too many distinct nodes\n", path);
+                return nullptr;
+            }
+            num_nodes = (uint) total;
+
+            auto dense = [&](uint64_t id) {
+                uint64_t below = words[id / 64] & (((uint64_t) 1 << (id % 64)) - 1);
+                return (uint) (rank[id / 64] + bitset::popcount(below));
+            };
+            run_tasks(num_threads, [&](uint t) {
+                auto& ids = chunks[t].ids;
+                for (size_t i = 0; i < chunks[t].num_edges; ++i) {
+                    ids[i] = ((uint64_t) dense(ids[2 * i]) << 32) | dense(ids[2 * i + 1]);
+                }
+            });
+
+            if (external_ids != nullptr) {
+                external_ids->clear();
+                external_ids->reserve(num_nodes);
+                for (size_t w = 0; w < num_words; ++w) {
+                    for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+                        external_ids->push_back(w * 64 + bitset::ctz(word));
+                    }
+                }
+            }
+        } else {
+            // sparse ids: binary search a sorted table of the distinct ids
+            // dedup each chunk on its own thread first, so the merged table is only as large as needed
+            std::vector<std::vector<uint64_t>> partial(num_threads);
+            run_tasks(num_threads, [&](uint t) { partial[t] = distinct_ids(chunks[t].ids); });
+            for (auto& ids : partial) {
+                distinct.insert(distinct.end(), ids.begin(), ids.end());
+                std::vector<uint64_t>().swap(ids);
+            }
+            std::sort(distinct.begin(), distinct.end());
+            distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+            if (distinct.size() >= graph::NIL) {
+                fprintf(stderr, "(io) %s has too many distinct nodes\n", path);
+                return nullptr;
+            }
+            num_nodes = (uint) distinct.size();
+
+            auto dense = [&](uint64_t id) {
+                return (uint) (std::lower_bound(distinct.begin(), distinct.end(), id) - distinct.begin());
+            };
+            run_tasks(num_threads, [&](uint t) {
+                auto& ids = chunks[t].ids;
+                for (size_t i = 0; i < chunks[t].num_edges; ++i) {
+                    ids[i] = ((uint64_t) dense(ids[2 * i]) << 32) | dense(ids[2 * i + 1]);
+                }
+            });
+
+            if (external_ids != nullptr) {
+                *external_ids = distinct;
+            }
+        }
+        distinct.clear();
+        distinct.shrink_to_fit();
+
+        // build
+        packed_edge_iterator begin = { &chunks, 0, 0 };
+        packed_edge_iterator end = { &chunks, chunks.size(), 0 };
+        begin.skip_exhausted();
+        return graph::build(num_nodes, begin, end, undirected, alloc);
+    }
+
+} // end namespace
+
+
+#endif
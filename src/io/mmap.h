@@ -0,0 +1,139 @@
+/*
+Read-only memory mapping of whole files, for POSIX and Windows.
+
+Mappings are shared, so every process that maps the same file reads the same physical pages out of the page cache.
+*/
+#ifndef MMAP_H
+#define MMAP_H
+
+
+#include <stdio.h>
+#include <stddef.h>
+#include <assert.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "../types.h"
+
+namespace io {
+    //// Types
+    typedef struct mapping Mapping;
+
+    //// forward declarations
+    // structs
+    struct mapping;
+
+    // functions
+    Mapping* map_file(const char*);
+    void unmap(Mapping*);
+    void release_mapping(void*);
+
+
+    //// Implementations
+    struct mapping {
+        const char* data;  // nullptr for an empty file
+        size_t size;  // bytes
+    #ifdef _WIN32
+        HANDLE file;
+        HANDLE view;
+    #endif
+    };
+
+    // Map the whole file at `path` read-only. Returns nullptr (and reports why on stderr) on failure.
+    Mapping*
+    map_file(const char* path) {
+        Mapping* mapping = new Mapping;
+        assert(mapping);
+        mapping->data = nullptr;
+        mapping->size = 0;
+
+    #ifdef _WIN32
+        mapping->view = NULL;
+        mapping->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (mapping->file == INVALID_HANDLE_VALUE) {
+            fprintf(stderr, "(io) Could not open %s\n", path);
+            delete mapping;
+            return nullptr;
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(mapping->file, &size);
+        mapping->size = (size_t) size.QuadPart;
+        if (mapping->size > 0) {
+            mapping->view = CreateFileMappingA(mapping->file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping->view != NULL) {
+                mapping->data = (const char*) MapViewOfFile(mapping->view, FILE_MAP_READ, 0, 0, 0);
+            }
+            if (mapping->data == nullptr) {
+                fprintf(stderr, "(io) Could not map %s\n", path);
+                unmap(mapping);
+                return nullptr;
+            }
+        }
+    #else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "(io) Could not open %s\n", path);
+            delete mapping;
+            return nullptr;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            fprintf(stderr, "(io) Could not stat %s\n", path);
+            close(fd);
+            delete mapping;
+            return nullptr;
+        }
+        mapping->size = (size_t) info.st_size;
+        if (mapping->size > 0) {
+            void* data = mmap(nullptr, mapping->size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED) {
+                fprintf(stderr, "(io) Could not map %s\n", path);
+                close(fd);
+                delete mapping;
+                return nullptr;
+            }
+            mapping->data = (const char*) data;
+        }
+        // the mapping keeps its own reference to the file
+        close(fd);
+    #endif
+
+        return mapping;
+    }
+
+    // Unmap a file mapped with map_file. Pointers into it become invalid.
+    void
+    unmap(Mapping* mapping) {
+    #ifdef _WIN32
+        if (mapping->data != nullptr) UnmapViewOfFile(mapping->data);
+        if (mapping->view != NULL) CloseHandle(mapping->view);
+        CloseHandle(mapping->file);
+    #else
+        if (mapping->data != nullptr) munmap((void*) mapping->data, mapping->size);
+    #endif
+        delete mapping;
+    }
+
+    // unmap, with a signature that fits graph::CSR::release_backing.
+    void
+    release_mapping(void* mapping) {
+        unmap((Mapping*) mapping);
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,460 @@
+/*
+JSON scenario files: everything needed to set up and run a simulation without recompiling.
+
+    {
+        "seed": 42,
+        "graph": { "generator": "erdos_renyi", "n": 32, "p": 0.1, "directed": true },
+        "layout": { "type": "circle", "radius": 10 },
+        "model": "sznajd",
+        "sampler": "edge",
+        "rates": { "type": "degree", "stubborn": 0.1, "stubborn_rate": 0.01 },
+        "steps": 100000,
+        "rate": 2.5,
+        "outputs": [
+            { "type": "histogram", "path": "histogram.csv", "every": 100 },
+            { "type": "snapshot", "path": "snapshot_{step}.json", "every": 10000 },
+            { "type": "binary", "path": "final.graph" }
+        ]
+    }
+
+Every key is optional; missing keys take the values of default_scenario (the original hard-coded demo).
+
+graph.generator is one of erdos_renyi (n, p, directed), erdos_renyi_m (n, m, directed), barabasi_albert (n, m),
+watts_strogatz (n, k, beta), ring_lattice (n, k), lattice (dims, periodic), planted_partition (blocks, block_size,
+p_in, p_out, directed), stochastic_block_model (sizes, probs, directed), or a file: binary, edge_list (undirected)
+or snapshot, each with a "path". graph.arena selects arena allocation.
+layout.type is circle (radius), grid (dims, spacing), force (radius, k, iterations) or none. A force layout starts
+from a circle and relaxes for `iterations` (default 0) before the run; the app keeps relaxing it in the background.
+Without a type, files and lattices keep the positions they come with and every other graph is put on a circle.
+model is voter or sznajd. steps = 0 runs until consensus; rate is steps per second when rendering.
+sampler is edge (apply the model to one uniformly sampled edge per step) or active_links (rejection-free: sample only
+edges where the model changes something, and skip ahead over the rest; see dynamics/active_links.h) or gillespie
+(continuous time: nodes act at their own rates, and each event is one step; see dynamics/gillespie.h).
+rates, for gillespie only, is degree (rate = out-degree, i.e. edge sampling in continuous time) or uniform (rate,
+default 1), with a random `stubborn` fraction of nodes (default 0) acting at `stubborn_rate` (default 0) instead.
+Output paths may contain {step}. An output without "every" is only written at the end of the run.
+*/
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "../types.h"
+#include "../random.h"  // rng::
+#include "../data_structures/graph.h"
+#include "../dynamics/utils.h"
+#include "../dynamics/models/voter_model.h"
+#include "../dynamics/models/sznajd.h"
+#include "../dynamics/diff.h"  // Diff
+#include "../dynamics/active_links.h"
+#include "../dynamics/gillespie.h"
+#include "../generators/erdos_renyi.h"
+#include "../generators/barabasi_albert.h"
+#include "../generators/watts_strogatz.h"
+#include "../generators/lattice.h"
+#include "../generators/stochastic_block_model.h"
+#include "../generators/layout.h"
+#include "../algorithms/force_layout.h"
+#include "binary.h"
+#include "edge_list.h"
+#include "snapshot.h"
+
+namespace io {
+    //// Types
+    typedef struct output Output;
+    typedef struct scenario Scenario;
+
+    enum model_type { MODEL_VOTER, MODEL_SZNAJD };
+    enum sampler_type { SAMPLER_EDGE, SAMPLER_ACTIVE_LINKS, SAMPLER_GILLESPIE };
+
+    //// forward declarations
+    // structs
+    struct output;
+    struct scenario;
+
+    // functions
+    Scenario default_scenario();
+    bool load_scenario(const char*, Scenario*);
+    graph::Graph* make_graph(const Scenario*);
+    active_links::Engine* make_engine(const Scenario*, graph::Graph*);
+    gillespie::Engine* make_clock(const Scenario*, graph::Graph*);
+    uint64_t next_output_step(const Scenario*, uint64_t);
+    bool is_finished(const Scenario*, const graph::Graph*, uint64_t);
+    void write_outputs(Scenario*, const graph::Graph*, uint64_t, bool);
+    void close_outputs(Scenario*);
+
+
+    //// Implementations
+    struct output {
+        std::string type;  // histogram, snapshot or binary
+        std::string path;
+        uint64_t every;  // write every this many steps; 0 for the end of the run only
+        FILE* fp;  // open histogram file, nullptr until the first write
+        uint64_t written;  // step of the last write, UINT64_MAX if none
+    };
+
+    struct scenario {
+        bool has_seed;
+        uint64_t seed;
+        nlohmann::json graph;  // generator name and parameters
+        nlohmann::json layout;
+        model_type model;
+        sampler_type sampler;
+        nlohmann::json rates;  // per-node rates for gillespie
+        uint64_t steps;  // 0 runs until consensus
+        double rate;  // steps per second when rendering
+        std::vector<Output> outputs;
+    };
+
+    // The original demo: a directed G(32, 0.1) on a circle, running the Sznajd model at 2.5 steps per second.
+    Scenario
+    default_scenario() {
+        Scenario scenario;
+        scenario.has_seed = false;
+        scenario.seed = 0;
+        scenario.graph = { {"generator", "erdos_renyi"}, {"n", 32}, {"p", 0.1}, {"directed", true} };
+        scenario.layout = { {"radius", 10.} };
+        scenario.model = MODEL_SZNAJD;
+        scenario.sampler = SAMPLER_EDGE;
+        scenario.rates = { {"type", "degree"} };
+        scenario.steps = 0;
+        scenario.rate = 2.5;
+        return scenario;
+    }
+
+    // Read the scenario at `path` into `scenario`, on top of the defaults.
+    // Returns false (and reports why on stderr) on failure.
+    bool
+    load_scenario(const char* path, Scenario* scenario) {
+        *scenario = default_scenario();
+
+        FILE* fp = fopen(path, "r");
+        if (! fp) {
+            fprintf(stderr, "(io) Could not open scenario %s\n", path);
+            return false;
+        }
+        try {
+            nlohmann::json config = nlohmann::json::parse(fp);
+            fclose(fp);
+            fp = nullptr;
+
+            if (config.contains("seed")) {
+                scenario->has_seed = true;
+                scenario->seed = config["seed"].get<uint64_t>();
+            }
+            if (config.contains("graph")) scenario->graph = config["graph"];
+            if (config.contains("layout")) scenario->layout = config["layout"];
+
+            std::string model = config.value("model", "sznajd");
+            if (model == "voter") scenario->model = MODEL_VOTER;
+            else if (model == "sznajd") scenario->model = MODEL_SZNAJD;
+            else {
+                fprintf(stderr, "(io) Unknown model '%s' in %s\n", model.c_str(), path);
+                return false;
+            }
+            std::string sampler = config.value("sampler", "edge");
+            if (sampler == "edge") scenario->sampler = SAMPLER_EDGE;
+            else if (sampler == "active_links") scenario->sampler = SAMPLER_ACTIVE_LINKS;
+            else if (sampler == "gillespie") scenario->sampler = SAMPLER_GILLESPIE;
+            else {
+                fprintf(stderr, "(io) Unknown sampler '%s' in %s\n", sampler.c_str(), path);
+                return false;
+            }
+            if (config.contains("rates")) scenario->rates = config["rates"];
+            scenario->steps = config.value("steps", scenario->steps);
+            scenario->rate = config.value("rate", scenario->rate);
+
+            for (auto& entry : config.value("outputs", nlohmann::json::array())) {
+                Output output;
+                output.type = entry.at("type").get<std::string>();
+                output.path = entry.at("path").get<std::string>();
+                output.every = entry.value("every", (uint64_t) 0);
+                output.fp = nullptr;
+                output.written = UINT64_MAX;
+                if (output.type != "histogram" && output.type != "snapshot" && output.type != "binary") {
+                    fprintf(stderr, "(io) Unknown output type '%s' in %s\n", output.type.c_str(), path);
+                    return false;
+                }
+                scenario->outputs.push_back(output);
+            }
+        } catch (const nlohmann::json::exception& e) {
+            if (fp) fclose(fp);
+            fprintf(stderr, "(io) Bad scenario %s: %s\n", path, e.what());
+            return false;
+        }
+        return true;
+    }
+
+    static inline bool
+    is_probability(double p) {
+        return p >= 0. && p <= 1.;  // false for NaN too
+    }
+
+    // Report graph parameters the generator would reject. Returns nullptr for make_graph to pass on.
+    static graph::Graph*
+    bad_graph(const std::string& generator, const char* why) {
+        fprintf(stderr, "(io) Bad %s parameters: %s\n", generator.c_str(), why);
+        return nullptr;
+    }
+
+    // Seed the random streams (rng::seed), then create, lay out and initialize the scenario's graph.
+    // Returns nullptr (and reports why on stderr) on failure.
+    graph::Graph*
+    make_graph(const Scenario* scenario) {
+        if (scenario->has_seed) {
+            rng::seed(scenario->seed);
+        }
+
+        graph::Graph* graph = nullptr;
+        const nlohmann::json& config = scenario->graph;
+        try {
+            std::string generator = config.value("generator", "");
+            graph::allocation alloc = config.value("arena", false) ? graph::ALLOC_ARENA : graph::ALLOC_MALLOC;
+
+            if (generator == "erdos_renyi") {
+                uint n = config.at("n").get<uint>();
+                double p = config.at("p").get<double>();
+                if (! is_probability(p)) return bad_graph(generator, "p must be in [0, 1]");
+                graph = generators::erdos_renyi(n, p, config.value("directed", true), alloc);
+            } else if (generator == "erdos_renyi_m") {
+                uint n = config.at("n").get<uint>();
+                uint64_t m = config.at("m").get<uint64_t>();
+                bool directed = config.value("directed", true);
+                if (m > generators::num_pairs(n, directed)) {
+                    return bad_graph(generator, "m exceeds the number of node pairs");
+                }
+                graph = generators::erdos_renyi_m(n, m, directed, alloc);
+            } else if (generator == "barabasi_albert") {
+                uint n = config.at("n").get<uint>();
+                uint m = config.at("m").get<uint>();
+                if (m < 1 || m >= n) return bad_graph(generator, "need 1 <= m < n");
+                graph = generators::barabasi_albert(n, m, alloc);
+            } else if (generator == "watts_strogatz") {
+                uint n = config.at("n").get<uint>();
+                uint k = config.at("k").get<uint>();
+                double beta = config.at("beta").get<double>();
+                if ((uint64_t) 2 * k >= n) return bad_graph(generator, "need 2 k < n");
+                if (! is_probability(beta)) return bad_graph(generator, "beta must be in [0, 1]");
+                if (beta > 0. && n == 2 * k + 1) return bad_graph(generator, "a complete ring cannot be rewired");
+                graph = generators::watts_strogatz(n, k, beta, alloc);
+            } else if (generator == "ring_lattice") {
+                uint n = config.at("n").get<uint>();
+                uint k = config.at("k").get<uint>();
+                if ((uint64_t) 2 * k >= n) return bad_graph(generator, "need 2 k < n");
+                graph = generators::ring_lattice(n, k, alloc);
+            } else if (generator == "lattice") {
+                std::vector<uint> dims = config.at("dims").get<std::vector<uint>>();
+                if (dims.empty() || dims.size() > 3) return bad_graph(generator, "dims must have 1 to 3 entries");
+                if (std::find(dims.begin(), dims.end(), 0u) != dims.end()) {
+                    return bad_graph(generator, "dims must be positive");
+                }
+                graph = generators::lattice(dims, config.value("periodic", true), alloc);
+            } else if (generator == "planted_partition") {
+                double p_in = config.at("p_in").get<double>();
+                double p_out = config.at("p_out").get<double>();
+                if (! is_probability(p_in) || ! is_probability(p_out)) {
+                    return bad_graph(generator, "p_in and p_out must be in [0, 1]");
+                }
+                graph = generators::planted_partition(config.at("blocks").get<uint>(),
+                    config.at("block_size").get<uint>(), p_in, p_out, config.value("directed", false), alloc);
+            } else if (generator == "stochastic_block_model") {
+                std::vector<uint> sizes = config.at("sizes").get<std::vector<uint>>();
+                std::vector<std::vector<double>> probs = config.at("probs").get<std::vector<std::vector<double>>>();
+                if (probs.size() != sizes.size()) return bad_graph(generator, "probs must have one row per block");
+                for (const auto& row : probs) {
+                    if (row.size() != sizes.size()) return bad_graph(generator, "probs must have one column per block");
+                    for (double p : row) {
+                        if (! is_probability(p)) return bad_graph(generator, "probs must be in [0, 1]");
+                    }
+                }
+                graph = generators::stochastic_block_model(sizes, probs, config.value("directed", false), alloc);
+            } else if (generator == "binary") {
+                graph = load(config.at("path").get<std::string>().c_str(), alloc);
+            } else if (generator == "edge_list") {
+                graph = read_edge_list(config.at("path").get<std::string>().c_str(),
+                    config.value("undirected", false), alloc);
+            } else if (generator == "snapshot") {
+                graph = load_snapshot(config.at("path").get<std::string>().c_str(), alloc);
+            } else {
+                fprintf(stderr, "(io) Unknown graph generator '%s'\n", generator.c_str());
+                return nullptr;
+            }
+            if (graph == nullptr) return nullptr;
+
+            // files come with a layout and opinions, and lattices with a grid, unless the scenario overrides them
+            bool from_file = (generator == "binary" || generator == "edge_list" || generator == "snapshot");
+            bool has_layout = from_file || generator == "lattice";
+            std::string layout = scenario->layout.value("type", has_layout ? "none" : "circle");
+            if (layout == "circle") {
+                generators::layout_circle(graph, scenario->layout.value("radius", 10.f));
+            } else if (layout == "force") {
+                generators::layout_circle(graph, scenario->layout.value("radius", 10.f));
+                layout::relax(graph, scenario->layout.value("iterations", 0u), scenario->layout.value("k", 1.f));
+            } else if (layout == "grid") {
+                std::vector<uint> dims = scenario->layout.at("dims").get<std::vector<uint>>();
+                uint64_t cells = 1;
+                for (uint d : dims) cells = std::min(cells * d, (uint64_t) UINT32_MAX + 1);
+                if (dims.size() > 3 || cells > graph->nodes.size()) {
+                    fprintf(stderr, "(io) Grid layout needs 1 to 3 dims with at most %zu cells\n", graph->nodes.size());
+                    graph::destroy(graph);
+                    return nullptr;
+                }
+                generators::layout_grid(graph, dims, scenario->layout.value("spacing", 1.f));
+            } else if (layout != "none") {
+                fprintf(stderr, "(io) Unknown layout '%s'\n", layout.c_str());
+                graph::destroy(graph);
+                return nullptr;
+            }
+            if (! from_file || generator == "edge_list" || config.value("randomize_opinions", false)) {
+                init_graph_opinions(graph);
+            }
+        } catch (const nlohmann::json::exception& e) {
+            fprintf(stderr, "(io) Bad graph description: %s\n", e.what());
+            if (graph != nullptr) graph::destroy(graph);
+            return nullptr;
+        }
+        return graph;
+    }
+
+    // Advance the scenario's model by one step, pushing opinion changes into `diff` if given.
+    template <typename URBG = decltype(rng::generator)>
+    void
+    step(const Scenario* scenario, graph::Graph* graph, Diff* diff = nullptr, URBG& gen = rng::generator) {
+        switch (scenario->model) {
+            case MODEL_VOTER: step_voter_dynamics(graph, sample_edge(graph, gen), diff); break;
+            case MODEL_SZNAJD: step_sznajd_dynamics(graph, sample_edge(graph, gen), diff); break;
+        }
+    }
+
+    // A rejection-free engine for the scenario's model on `graph`, or nullptr if the scenario samples plain edges.
+    // Runs that use one advance with active_links::advance instead of step.
+    active_links::Engine*
+    make_engine(const Scenario* scenario, graph::Graph* graph) {
+        if (scenario->sampler != SAMPLER_ACTIVE_LINKS) return nullptr;
+        return active_links::make(graph,
+            (scenario->model == MODEL_VOTER) ? active_links::RULE_VOTER : active_links::RULE_SZNAJD);
+    }
+
+    // A continuous-time engine with the scenario's rates on `graph`, or nullptr if the scenario does not use one or
+    // (reported on stderr) its rates are bad. Runs that use one advance with gillespie::advance instead of step.
+    gillespie::Engine*
+    make_clock(const Scenario* scenario, graph::Graph* graph) {
+        if (scenario->sampler != SAMPLER_GILLESPIE) return nullptr;
+
+        std::vector<double> rates;
+        const nlohmann::json& config = scenario->rates;
+        try {
+            std::string type = config.value("type", "degree");
+            if (type == "degree") {
+                rates = gillespie::degree_rates(graph);
+            } else if (type == "uniform") {
+                rates.assign(graph->nodes.size(), config.value("rate", 1.));
+            } else {
+                fprintf(stderr, "(io) Unknown rates type '%s'\n", type.c_str());
+                return nullptr;
+            }
+            double stubborn = config.value("stubborn", 0.);
+            double stubborn_rate = config.value("stubborn_rate", 0.);
+            if (stubborn > 0.) {
+                std::bernoulli_distribution is_stubborn(std::min(stubborn, 1.));
+                for (auto& rate : rates) {
+                    if (is_stubborn(rng::generator)) rate = stubborn_rate;
+                }
+            }
+            for (double rate : rates) {
+                if (! (rate >= 0.) || std::isinf(rate)) {
+                    fprintf(stderr, "(io) Rates must be finite and non-negative\n");
+                    return nullptr;
+                }
+            }
+        } catch (const nlohmann::json::exception& e) {
+            fprintf(stderr, "(io) Bad rates description: %s\n", e.what());
+            return nullptr;
+        }
+        gillespie::step_rule rule = step_sznajd_dynamics;
+        if (scenario->model == MODEL_VOTER) rule = step_voter_dynamics;
+        return gillespie::make(graph, rule, rates);
+    }
+
+    // The first step after `step` at which a periodic output is due, or UINT64_MAX if there is none.
+    // Runs that skip steps stop there so that write_outputs sees it.
+    uint64_t
+    next_output_step(const Scenario* scenario, uint64_t step) {
+        uint64_t next = UINT64_MAX;
+        for (const auto& output : scenario->outputs) {
+            if (output.every == 0) continue;
+            uint64_t due = (step / output.every + 1) * output.every;
+            if (due > step) next = std::min(next, due);
+        }
+        return next;
+    }
+
+    // Whether a run that has taken `steps` steps is over.
+    bool
+    is_finished(const Scenario* scenario, const graph::Graph* graph, uint64_t steps) {
+        if (scenario->steps > 0) return steps >= scenario->steps;
+        return graph->edges.empty() || is_consensus_reached(&graph->properties);
+    }
+
+    // Replace every "{step}" in `path` with the step number.
+    static std::string
+    expand_path(const std::string& path, uint64_t step) {
+        std::string expanded = path;
+        std::string number = std::to_string(step);
+        for (size_t at = expanded.find("{step}"); at != std::string::npos; at = expanded.find("{step}", at)) {
+            expanded.replace(at, 6, number);
+            at += number.size();
+        }
+        return expanded;
+    }
+
+    // Write every output that is due after `step` steps. With `last`, write every output not yet written at `step`.
+    void
+    write_outputs(Scenario* scenario, const graph::Graph* graph, uint64_t step, bool last) {
+        for (auto& output : scenario->outputs) {
+            bool due = last || (output.every > 0 && step % output.every == 0);
+            if (! due || output.written == step) continue;
+            output.written = step;
+
+            std::string path = expand_path(output.path, step);
+            if (output.type == "histogram") {
+                if (output.fp == nullptr) {
+                    output.fp = fopen(path.c_str(), "w");
+                    if (output.fp == nullptr) {
+                        fprintf(stderr, "(io) Could not open %s for writing\n", path.c_str());
+                        output.type = "";  // stop trying
+                        continue;
+                    }
+                    fprintf(output.fp, "step,false,true\n");
+                }
+                auto histogram = opinion_histogram(graph);
+                fprintf(output.fp, "%llu,%u,%u\n", (unsigned long long) step, histogram.first, histogram.second);
+            } else if (output.type == "snapshot") {
+                save_snapshot(graph, path.c_str());
+            } else if (output.type == "binary") {
+                save(graph, path.c_str());
+            }
+        }
+    }
+
+    // Flush and close any files held open by outputs.
+    void
+    close_outputs(Scenario* scenario) {
+        for (auto& output : scenario->outputs) {
+            if (output.fp != nullptr) fclose(output.fp);
+            output.fp = nullptr;
+        }
+    }
+
+} // end namespace
+
+
+#endif
@@ -0,0 +1,235 @@
+/*
+JSON graph snapshots, written and read as a stream so that neither side ever holds a JSON document tree:
+
+    {
+        "format": "opinion-dynamics-snapshot", "version": 1,
+        "undirected": false, "num_nodes": 3,
+        "x": [ ... ], "y": [ ... ], "opinion": [ 0, 1, 1 ], "block": [ ... ],
+        "edges": [ [0, 1], [1, 2] ]
+    }
+
+Columns have one entry per node; "block" is optional. Undirected graphs list each edge once.
+The writer prints straight to a FILE*, and the reader drives nlohmann::json's SAX interface over a memory-mapped
+file, appending numbers directly into the property columns and the edge list.
+*/
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "../types.h"
+#include "../data_structures/graph.h"
+#include "../data_structures/builder.h"  // graph::build
+#include "mmap.h"
+
+#define SNAPSHOT_FORMAT "opinion-dynamics-snapshot"
+#define SNAPSHOT_VERSION (1)
+
+namespace io {
+
+    // Write `values` as a JSON array, one printf-formatted element at a time.
+    template <typename T>
+    static void
+    write_column(FILE* fp, const char* key, const std::vector<T>& values, const char* format) {
+        fprintf(fp, ",\n\"%s\":[", key);
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i > 0) fputc(',', fp);
+            fprintf(fp, format, values[i]);
+        }
+        fputc(']', fp);
+    }
+
+    // Write a JSON snapshot of `graph` to `path`. Returns false (and reports why on stderr) on failure.
+    bool
+    save_snapshot(const graph::Graph* graph, const char* path) {
+        FILE* fp = fopen(path, "w");
+        if (! fp) {
+            fprintf(stderr, "(io) Could not open %s for writing\n", path);
+            return false;
+        }
+
+        const graph::Properties& properties = graph->properties;
+        uint num_nodes = (uint) graph->nodes.size();
+        fprintf(fp, "{\"format\":\"%s\",\"version\":%d,\"undirected\":%s,\"num_nodes\":%u",
+            SNAPSHOT_FORMAT, SNAPSHOT_VERSION, graph->is_undirected ? "true" : "false", num_nodes);
+
+        // 9 significant digits round-trip a float exactly
+        write_column(fp, "x", properties.x, "%.9g");
+        write_column(fp, "y", properties.y, "%.9g");
+        fprintf(fp, ",\n\"opinion\":[");
+        for (uint n = 0; n < num_nodes; ++n) {
+            if (n > 0) fputc(',', fp);
+            fputc(graph::opinion(graph, n) ? '1' : '0', fp);
+        }
+        fputc(']', fp);
+        if (! properties.block.empty()) {
+            write_column(fp, "block", properties.block, "%u");
+        }
+
+        fprintf(fp, ",\n\"edges\":[");
+        bool first = true;
+        for (uint n = 0; n < num_nodes; ++n) {
+            const graph::Node* node = graph->nodes[n];
+            for (uint i = 0; i < node->num_adjacent; ++i) {
+                uint dest = node->adjacent[i];
+                if (graph->is_undirected && dest < n) continue;
+                fprintf(fp, first ? "[%u,%u]" : ",[%u,%u]", n, dest);
+                first = false;
+            }
+        }
+        fprintf(fp, "]}\n");
+
+        bool ok = (ferror(fp) == 0);
+        if (fclose(fp) != 0) ok = false;
+        if (! ok) {
+            fprintf(stderr, "(io) Error writing %s\n", path);
+        }
+        return ok;
+    }
+
+    // SAX handler for snapshots. Only top-level keys are recognized; anything else is skipped.
+    struct snapshot_reader {
+        typedef nlohmann::json json;
+
+        std::string current;  // current top-level key
+        int depth;  // nesting depth, 1 inside the top-level object
+        bool undirected;
+        bool has_format;
+        uint num_nodes;
+        graph::Properties properties;
+        std::vector<bool> opinion;
+        std::vector<graph::edge_t> edges;
+        std::vector<uint> pair;  // endpoints of the edge being read
+        std::string error;
+
+        bool value(double number) {
+            if (depth == 2) {
+                if (current == "x") properties.x.push_back((float) number);
+                else if (current == "y") properties.y.push_back((float) number);
+                else if (current == "opinion") opinion.push_back(number != 0.);
+                else if (current == "block") properties.block.push_back((uint) number);
+            } else if (depth == 3 && current == "edges") {
+                pair.push_back((uint) number);
+            } else if (depth == 1 && current == "num_nodes") {
+                num_nodes = (uint) number;
+            } else if (depth == 1 && current == "version" && number != SNAPSHOT_VERSION) {
+                error = "unsupported snapshot version";
+                return false;
+            }
+            return true;
+        }
+
+        bool null() { return true; }
+        bool boolean(bool flag) {
+            if (depth == 1 && current == "undirected") undirected = flag;
+            return true;
+        }
+        bool number_integer(json::number_integer_t number) { return value((double) number); }
+        bool number_unsigned(json::number_unsigned_t number) { return value((double) number); }
+        bool number_float(json::number_float_t number, const json::string_t&) { return value(number); }
+        bool string(json::string_t& text) {
+            if (depth == 1 && current == "format") {
+                if (text != SNAPSHOT_FORMAT) {
+                    error = "not a graph snapshot";
+                    return false;
+                }
+                has_format = true;
+            }
+            return true;
+        }
+        bool binary(json::binary_t&) { return true; }
+        bool start_object(size_t) {
+            ++depth;
+            return true;
+        }
+        bool end_object() {
+            --depth;
+            return true;
+        }
+        bool key(json::string_t& name) {
+            if (depth == 1) current = name;
+            return true;
+        }
+        bool start_array(size_t) {
+            ++depth;
+            if (depth == 3 && current == "edges") pair.clear();
+            return true;
+        }
+        bool end_array() {
+            if (depth == 3 && current == "edges") {
+                if (pair.size() != 2) {
+                    error = "edges must be [source, dest] pairs";
+                    return false;
+                }
+                edges.push_back(std::make_pair(pair[0], pair[1]));
+            }
+            --depth;
+            return true;
+        }
+        bool parse_error(size_t, const std::string&, const nlohmann::detail::exception& e) {
+            error = e.what();
+            return false;
+        }
+    };
+
+    // Read a JSON snapshot written by save_snapshot into a new graph.
+    // Returns nullptr (and reports why on stderr) on failure.
+    graph::Graph*
+    load_snapshot(const char* path, graph::allocation alloc = graph::ALLOC_MALLOC) {
+        Mapping* mapping = map_file(path);
+        if (mapping == nullptr) return nullptr;
+
+        snapshot_reader reader;
+        reader.depth = 0;
+        reader.undirected = false;
+        reader.has_format = false;
+        reader.num_nodes = 0;
+        const char* begin = mapping->data;
+        const char* end = mapping->data + mapping->size;
+        bool ok = nlohmann::json::sax_parse(begin, end, &reader);
+        unmap(mapping);
+
+        uint n = reader.num_nodes;
+        if (ok && ! reader.has_format) {
+            reader.error = "not a graph snapshot";
+            ok = false;
+        }
+        if (ok && (reader.properties.x.size() != n || reader.properties.y.size() != n || reader.opinion.size() != n
+            || (! reader.properties.block.empty() && reader.properties.block.size() != n))) {
+            reader.error = "property columns do not match num_nodes";
+            ok = false;
+        }
+        for (size_t i = 0; ok && i < reader.edges.size(); ++i) {
+            if (reader.edges[i].first >= n || reader.edges[i].second >= n) {
+                reader.error = "edge endpoint out of range";
+                ok = false;
+            }
+        }
+        if (! ok) {
+            fprintf(stderr, "(io) Could not read snapshot %s: %s\n", path, reader.error.c_str());
+            return nullptr;
+        }
+
+        graph::Graph* graph = graph::build(n, reader.edges, reader.undirected, alloc);
+        reader.edges.clear();
+        reader.edges.shrink_to_fit();
+        graph->properties.x.swap(reader.properties.x);
+        graph->properties.y.swap(reader.properties.y);
+        graph->properties.block.swap(reader.properties.block);
+        for (uint i = 0; i < n; ++i) {
+            graph::set_opinion(graph, i, reader.opinion[i]);
+        }
+        return graph;
+    }
+
+} // end namespace
+
+
+#endif
@@ -41,21 +41,28 @@ float fps{ 0.f };
 void devmode_toggle(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 // Graph
-#define TEST_SIZE (32)
-//#define TEST_SIMULATION_STEPS (100)
-
-// From voter_model_test.cpp
 #include "types.h"
 #include "data_structures/graph.h"
-// #include "models/voter_model.h"
-#include "dynamics/models/sznajd.h"
 #include "dynamics/utils.h"
 #include "random.h"
+// Scenario (graph, model, parameters and outputs)
+#include "io/scenario.h"
+// Simulation thread
+#include "dynamics/worker.h"
+// Background layout
+#include "algorithms/force_layout.h"
 
-#include "nlohmann/json.hpp"
-
+// scenario, from the file named on the command line or the built-in default
+io::Scenario scenario;
 // graph
 graph::Graph* graph1 { nullptr };
+// simulation thread
+worker::Worker* simulation { nullptr };
+// opinion changes from the simulation thread, used to patch the GPU copy of the opinions
+#define SIMULATION_DIFF_CAPACITY (1 << 16)
+Diff opinionChanges;
+// force-directed layout relaxing on its own thread, if the scenario asks for one
+layout::Layout* graphLayout { nullptr };
 // updating
 bool simulating{ true };
 // selected node
@@ -64,34 +71,18 @@ uint selectedNode{ 0 };
 // current position of mouse in world coords
 glm::vec4 cPos;
 
-int main(void)
+int main(int argc, char** argv)
 {
     cPos = glm::vec4(0.f, 0.f, 0.f, 0.f);
-    // Make a Graph
-    graph1 = graph::make(TEST_SIZE);  // undirected graph
-    init_graph_opinions(graph1);  // uniform-random opinions
-    // add edges
-    std::bernoulli_distribution dist(0.1f);
-    for (uint n = 0; n < graph1->nodes.size(); ++n) {
-        for (uint k = 0; k < graph1->nodes.size(); ++k) {
-            if (n == k) continue;
-            if (dist(rng::generator)) {
-                graph::add_edge(graph1, n, k);
-            }
-        }
-    }
-    // move 'em around
-    // theta
-    float pi = 4. * atan(1.f);
-    float theta = 0.0f;
-    float radius = 3.f;
-    for (uint n = 0; n < graph1->nodes.size(); ++n) {
-        theta = (float)n * 2.0f * pi / (float)(graph1->nodes.size());
-        float x = 10.f*cos(theta);
-        float y = 10.f*sin(theta);
-        graph1->nodes[n]->properties->x = x;
-        graph1->nodes[n]->properties->y = y;
+    // Load the scenario: opinion-dynamics [scenario.json]
+    if (argc > 1) {
+        if (! io::load_scenario(argv[1], &scenario)) return EXIT_FAILURE;
+    } else {
+        scenario = io::default_scenario();
     }
+    // Make a Graph (generated, laid out and with initial opinions)
+    graph1 = io::make_graph(&scenario);
+    if (graph1 == nullptr) return EXIT_FAILURE;
 
     /* Initialize Graphics */
     graphics::init();
@@ -109,14 +100,14 @@ int main(void)
                             &graphics::shaderText);
     // Load Vertex Data (for Quad)
     graphics::load_buffers();
+    // Load per-instance buffers for the graph
+    graphics::load_graph_buffers(graph1);
     // Load Texture Data
     graphics::load_texture("../../res/node.png", &graphics::textureNode);               // Node
     graphics::load_texture("../../res/line.png", &graphics::textureEdge);               // Edge
     graphics::load_texture("../../res/font/MS_Gothic.png", &graphics::textureFont);     // Font
     // Set Texture Data (defines texture samplers in shader program)
-    // NOTE (jllusty): As the program swaps between shaders and active / bound textures,
-    //                 I don't think this can be done before the render loop (unsure).
-    // graphics::set_textures();
+    graphics::set_textures();
     
     /* Initialize OpenAL */
     audio::init();
@@ -125,9 +116,17 @@ int main(void)
     // add a source
     ALuint* pSource1 = audio::create_source();
 
+    /* Start stepping the dynamics on their own thread, at the scenario's rate */
+    ring_buffer::init(&opinionChanges, SIMULATION_DIFF_CAPACITY);
+    simulation = worker::start(graph1, &scenario, scenario.rate, false, &opinionChanges);
+    graphics::follow_opinions();
+    if (scenario.layout.value("type", "") == "force") {
+        graphLayout = layout::make(graph1, scenario.layout.value("k", 1.f));
+        layout::start(graphLayout);
+    }
+
     /* Loop until the user closes the window */
     glfwSetTime(0.0);
-    uint currentSecond{ 0 };
     long frames = 0;
     float oldfps = 0;
     while (!glfwWindowShouldClose(graphics::window))
@@ -146,12 +145,8 @@ int main(void)
             oldfps = fps;
         } else { frames = 0; fps = 0.0f; oldfps = 0.0f; }
 
-        // update graph every 1/5 second of realtime
-        if ((uint)(2.5f*currentFrame) > currentSecond) {
-            currentSecond++;
-            if (! simulating) continue;
-            step_sznajd_dynamics(graph1, sample_edge(graph1));
-        }
+        /* Take the newest layout positions, before input moves a dragged node */
+        if (graphLayout && layout::sync(graphLayout, &graph1->properties)) graphics::positions_changed();
 
         /* Process Input */
         processInput(graphics::window);
@@ -178,6 +173,16 @@ int main(void)
     graphics::cleanup();
 
     /* Graph */
+    // stop the layout and simulation threads, then write final outputs
+    if (graphLayout) {
+        layout::stop(graphLayout);
+        layout::sync(graphLayout, &graph1->properties);
+        layout::destroy(graphLayout);
+    }
+    uint64_t steps = simulation->steps.load();
+    worker::stop(simulation);
+    io::write_outputs(&scenario, graph1, steps, true);
+    io::close_outputs(&scenario);
     // free the graph
     graph::destroy(graph1);
 
@@ -210,34 +215,20 @@ void processInput(GLFWwindow *window) {
         // are we already touchy-touching a node?
         if (!nodeSelected) {
             // if not, are we touchy-touching one now?
-            bool selected{ false };
-            // make view and projection matrices
+            // mouse position in normalized screen coordinates, inverted into world coordinates
+            glm::vec4 mPos{ 2.f*mouse.x/graphics::scr_width-1.f, -2.f*mouse.y/graphics::scr_height+1.f, 0.0f, 1.0f };
             glm::mat4 view  = glm::mat4(1.0f);
             glm::mat4 proj  = glm::mat4(1.0f);
             view = glm::lookAt(camera.pos, camera.pos + camera.front, camera.up);
             float aspect = (float)graphics::scr_width/(float)graphics::scr_height;
             float zoom = camera.pos.z;
             proj = glm::ortho(-zoom*aspect, zoom*aspect, -zoom, zoom, 0.1f, 100.0f);
-            for (uint n = 0; n < graph1->nodes.size(); ++n) {
-                // get position of node in view coords
-                glm::mat4 model = glm::mat4(1.0f);
-                glm::vec3 nodePosition{ graph1->nodes[n]->properties->x, graph1->nodes[n]->properties->y, 0.0f };
-                model = glm::translate(model, nodePosition);
-                // origin
-                glm::vec4 oPos = proj * view * model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0);
-                    oPos = oPos / oPos.w;
-                // edge of texture
-                glm::vec4 ePos = proj * view * model * glm::vec4(1.0f, 0.0f, 0.0f, 1.0);
-                    ePos = ePos / ePos.w;
-                // radius
-                float r = glm::distance(oPos, ePos);
-                // mouse position in normalized screen coordinates
-                glm::vec2 mPos{ 2.f*mouse.x/graphics::scr_width-1.f, -2.f*mouse.y/graphics::scr_height+1.f };
-                // get distance from node origin to mouse position
-                float dMouse = glm::distance(glm::vec2(oPos.x, oPos.y), mPos);
-                if (dMouse < r) { selected = true; selectedNode = n; nodeSelected = true; break; }
-            }
-            if (!selected) { nodeSelected = false; }
+            glm::vec4 wPos = glm::inverse(proj * view) * mPos;
+                wPos = wPos / wPos.w;
+            // look the node up in the spatial grid rather than testing every node
+            uint n = graphics::pick(wPos.x, wPos.y);
+            if (n != graph::NIL) { selectedNode = n; nodeSelected = true; }
+            else { nodeSelected = false; }
         }
         // if we touchy-touched a node and the user is still holding down the mouse,
         // drag that little 'en along
@@ -253,18 +244,23 @@ void processInput(GLFWwindow *window) {
             proj = glm::ortho(-zoom*aspect, zoom*aspect, -zoom, zoom, 0.1f, 100.0f);
             glm::mat4 model = glm::mat4(1.0f);
             //proj = glm::perspective(glm::radians(45.0f), (float)graphics::scr_width/(float)graphics::scr_height, 0.1f, 100.f);
-            glm::vec3 nodePosition{ graph1->nodes[selectedNode]->properties->x, graph1->nodes[selectedNode]->properties->y, 0.0f };
+            glm::vec3 nodePosition{ graph1->properties.x[selectedNode], graph1->properties.y[selectedNode], 0.0f };
             model = glm::translate(model, nodePosition);
             glm::mat4 invCamera = glm::inverse(proj * view);
             cPos = invCamera * mPos;
                 cPos = cPos / cPos.w;
-            auto newNode = graph1->nodes[selectedNode];
-            newNode->properties->x = cPos.x;
-            newNode->properties->y = cPos.y;
+            graph1->properties.x[selectedNode] = cPos.x;
+            graph1->properties.y[selectedNode] = cPos.y;
+            graphics::positions_changed();
+            // the layout relaxes around the dragged node
+            if (graphLayout) layout::hold(graphLayout, selectedNode, cPos.x, cPos.y);
         }
     }
     // we aren't touchy-touching anything
-    else { nodeSelected = false; }
+    else {
+        nodeSelected = false;
+        if (graphLayout) layout::release(graphLayout);
+    }
 }
 
 // devmode toggle, also other toggles
@@ -273,8 +269,23 @@ void devmode_toggle(GLFWwindow* window, int key, int scancode, int action, int m
     if(key == GLFW_KEY_F1 && action == GLFW_PRESS)
         devmode = !devmode;
     // pause / play simulation
-    if(key == GLFW_KEY_P && action == GLFW_PRESS)
+    if(key == GLFW_KEY_P && action == GLFW_PRESS) {
         simulating = !simulating;
+        worker::set_paused(simulation, !simulating);
+    }
+    // simulation rate: [ halves, ] doubles, backslash toggles running as fast as possible
+    if(key == GLFW_KEY_LEFT_BRACKET && action == GLFW_PRESS && scenario.rate > 0.) {
+        scenario.rate = std::max(scenario.rate / 2., 0.25);
+        worker::set_rate(simulation, scenario.rate);
+    }
+    if(key == GLFW_KEY_RIGHT_BRACKET && action == GLFW_PRESS && scenario.rate > 0.) {
+        scenario.rate *= 2.;
+        worker::set_rate(simulation, scenario.rate);
+    }
+    if(key == GLFW_KEY_BACKSLASH && action == GLFW_PRESS) {
+        scenario.rate = (scenario.rate > 0.) ? 0. : 2.5;
+        worker::set_rate(simulation, scenario.rate);
+    }
 }
 
 // window resizing
@@ -14,6 +14,9 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+// Shader Programs and Bound State
+#include "program.h"
+
 // Camera
 #include "camera.h"
 extern Camera camera;
@@ -29,10 +32,16 @@ extern bool simulating;
 //extern glm::vec3 nodePositions[];
 //extern glm::vec3 nodeColors[];
 
+#include <vector>
+
 #include "types.h"
 #include "data_structures/graph.h"
+#include "data_structures/spatial_grid.h"
+#include "dynamics/worker.h"
 // #include "models/voter_model.h"
 extern graph::Graph* graph1;
+// simulation thread, source of opinion snapshots
+extern worker::Worker* simulation;
 
 // selected nodes
 extern bool nodeSelected;
@@ -50,11 +59,45 @@ namespace graphics {
     GLsizei scr_height{ 480 };
 
     // ShaderProgram
-    GLuint shaderGraph;    // Shader Program for Drawing Graph
-    GLuint shaderText;     // Shader Program for Drawing On-Screen Text
+    program::Program shaderGraph;    // Shader Program for Drawing Graph
+    program::Program shaderText;     // Shader Program for Drawing On-Screen Text
+    program::StateCache glState;     // bound program and textures, to skip redundant binds
 
     // Buffer Objects
     GLuint VBO, VAO, EBO;
+
+    // Graph Buffers (instanced drawing: one instance per node, one per wire)
+    GLuint nodeVAO, edgeVAO;            // unit quad plus per-instance state
+    GLuint nodeInstanceBuffer;          // every node id
+    GLuint edgeInstanceBuffer;          // (source, dest) node ids per wire
+    GLsizei numWires{ 0 };
+    GLuint positionBuffer, positionTexture;   // x column then y column, as a buffer texture
+    GLuint opinionBuffer, opinionTexture;     // packed opinion bitset, as a buffer texture
+    GLsizei numGraphNodes{ 0 };
+
+    // Opinion Uploads (the GPU copy is patched only where the simulation's change stream says it changed)
+    #define OPINION_STAGING_SLOTS 3   // staging buffers in flight, each fenced so the CPU never waits on the GPU
+    #define OPINION_RUN_GAP 8         // dirty words this close together are uploaded as one run
+    GLuint opinionStaging[OPINION_STAGING_SLOTS];
+    GLsync opinionFences[OPINION_STAGING_SLOTS]{};
+    uint opinionSlot{ 0 };
+    worker::Follower opinionFollower;
+    bitset::Bitset opinionDirty;                        // one bit per opinion word changed since its last upload
+    size_t opinionDirtyWords{ 0 };
+    bool opinionStale{ true };                          // the whole buffer needs uploading
+    std::vector<std::pair<size_t, size_t>> opinionRuns; // [first, last) dirty words, reused between frames
+
+    // Culling and Picking (node quads span NODE_RADIUS around the node, wire quads as much either side)
+    #define NODE_RADIUS (1.f)
+    spatial_grid::Grid nodeGrid;        // nodes bucketed by position, rebuilt after they move
+    bool nodeGridStale{ true };
+    std::vector<GLuint> wireEndpoints;  // CPU copy of edgeInstanceBuffer
+    spatial_grid::Grid wireGrid;        // wires bucketed by midpoint, rebuilt after nodes move
+    bool wireGridStale{ true };
+    std::vector<float> wireMidX, wireMidY;
+    float wireHalfX{ 0.f }, wireHalfY{ 0.f };  // largest half-extent of a wire along each axis
+    std::vector<GLuint> visibleNodes, visibleWires;
+    GLuint visibleNodeBuffer, visibleWireBuffer;  // this frame's on-screen instances, when some are off-screen
     
     // Textures
     GLuint textureNode;    // Node
@@ -66,11 +109,23 @@ namespace graphics {
     // Cleanup
     void cleanup(void);
     // Create Shader Program
-    void create_shader(const char* vertexShaderFilename, const char* fragShaderFilename);
+    void create_shader(const char* vertexShaderFilename, const char* fragShaderFilename, program::Program* shaderProgram);
     // Load buffer objects for GL_QUAD
     void load_buffers(void);
     // Cleanup buffer objects
     void destroy_buffers(void);
+    // Load per-instance buffers for a graph whose topology stays fixed
+    void load_graph_buffers(const graph::Graph* graph);
+    // Cleanup per-instance buffers
+    void destroy_graph_buffers(void);
+    // Start patching opinions from the simulation's change ring
+    void follow_opinions(void);
+    // Upload opinion words changed since the last upload
+    void upload_opinions(void);
+    // Note that node positions changed (layout, dragging), so the spatial grid needs rebuilding
+    void positions_changed(void);
+    // The node under world position (x, y), or graph::NIL
+    uint pick(float x, float y);
     // Load Texture
     void load_texture(const char* filename);
     // Display
@@ -117,15 +172,16 @@ namespace graphics {
     }
     // Cleanup
     void cleanup(void) {
-        glDeleteProgram(shaderGraph);
-        glDeleteProgram(shaderText);
+        destroy_graph_buffers();
+        program::destroy(&shaderGraph);
+        program::destroy(&shaderText);
 
         /* GLFW: clean-up */
         glfwTerminate();
     }
 
     // Create Shader Program
-    void create_shader(const char* vertexShaderFilename, const char* fragShaderFilename, GLuint* shaderProgram) {
+    void create_shader(const char* vertexShaderFilename, const char* fragShaderFilename, program::Program* shaderProgram) {
         // allocate & load vertex source
         GLchar* pVertexSource = read_glsl(vertexShaderFilename);
         GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -153,20 +209,20 @@ namespace graphics {
         }
         free(pFragSource);
         // create and link shader program
-        *shaderProgram = glCreateProgram();
-        glAttachShader(*shaderProgram, vertexShader);
-        glAttachShader(*shaderProgram, fragShader);
-        glLinkProgram(*shaderProgram);
+        GLuint id = glCreateProgram();
+        glAttachShader(id, vertexShader);
+        glAttachShader(id, fragShader);
+        glLinkProgram(id);
         // check if linking was successful
-        glGetProgramiv(*shaderProgram, GL_LINK_STATUS, &success);
+        glGetProgramiv(id, GL_LINK_STATUS, &success);
         if(!success) {
-            glGetProgramInfoLog(*shaderProgram, 512, NULL, infoLog);
+            glGetProgramInfoLog(id, 512, NULL, infoLog);
             fprintf(stderr, "(OpenGL) Error, linking failed:\n%s\n", infoLog);
         }
         glDeleteShader(vertexShader);
         glDeleteShader(fragShader);
-        // use shader
-        // glUseProgram(shaderProgram);
+        // resolve uniform and attribute locations once
+        program::reflect(shaderProgram, id);
     }
 
     // Load Buffers with Vertex Data
@@ -220,6 +276,264 @@ namespace graphics {
         glDeleteBuffers(1, &EBO);
     }
 
+    // Load per-instance graph buffers. Wires are drawn once per edge, or once per pair for undirected graphs;
+    // node positions and opinions are read in the vertex shader from buffer textures indexed by node id.
+    void load_graph_buffers(const graph::Graph* graph) {
+        numGraphNodes = (GLsizei)graph->nodes.size();
+
+        // wire endpoints, fixed for the life of the graph
+        std::vector<GLuint>& endpoints = wireEndpoints;
+        endpoints.clear();
+        endpoints.reserve(2 * graph->edges.size());
+        for (const auto& edge : graph->edges) {
+            if (graph->is_undirected && edge.second < edge.first) continue;
+            endpoints.push_back(edge.first);
+            endpoints.push_back(edge.second);
+        }
+        numWires = (GLsizei)(endpoints.size() / 2);
+        glGenBuffers(1, &edgeInstanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, edgeInstanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, endpoints.size() * sizeof(GLuint), endpoints.data(), GL_STATIC_DRAW);
+        // node ids, for frames that draw every node
+        std::vector<GLuint> ids(numGraphNodes);
+        for (GLsizei n = 0; n < numGraphNodes; ++n) ids[n] = (GLuint)n;
+        glGenBuffers(1, &nodeInstanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, nodeInstanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+        // culled instances, rewritten on frames where part of the graph is off-screen
+        glGenBuffers(1, &visibleNodeBuffer);
+        glGenBuffers(1, &visibleWireBuffer);
+        nodeGridStale = wireGridStale = true;
+
+        // positions: x column then y column (R32F), rewritten every frame
+        glGenBuffers(1, &positionBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, positionBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, 2 * (size_t)numGraphNodes * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+        glGenTextures(1, &positionTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, positionTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, positionBuffer);
+
+        // opinions: the bitset's words as-is (R32UI, 32 nodes per texel on little-endian hosts), starting from the
+        // graph's current opinions and afterwards patched from staging buffers of the same layout
+        size_t opinionBytes = graph->properties.opinion.words.size() * sizeof(uint64_t);
+        if (opinionBytes == 0) opinionBytes = sizeof(uint64_t);
+        glGenBuffers(1, &opinionBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, opinionBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, opinionBytes, NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, graph->properties.opinion.words.size() * sizeof(uint64_t),
+                        graph->properties.opinion.words.data());
+        glGenTextures(1, &opinionTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, opinionTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, opinionBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glGenBuffers(OPINION_STAGING_SLOTS, opinionStaging);
+        for (int slot = 0; slot < OPINION_STAGING_SLOTS; ++slot) {
+            glBindBuffer(GL_COPY_READ_BUFFER, opinionStaging[slot]);
+            glBufferData(GL_COPY_READ_BUFFER, opinionBytes, NULL, GL_STREAM_DRAW);
+            opinionFences[slot] = 0;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        opinionSlot = 0;
+
+        // one VAO per instance kind, both sharing the unit quad
+        for (int kind = 0; kind < 2; ++kind) {
+            GLuint* vao = (kind == 0) ? &nodeVAO : &edgeVAO;
+            glGenVertexArrays(1, vao);
+            glBindVertexArray(*vao);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
+            glEnableVertexAttribArray(2);
+            if (kind == 0) {
+                // node id attribute, advancing once per instance
+                glBindBuffer(GL_ARRAY_BUFFER, nodeInstanceBuffer);
+                glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+                glEnableVertexAttribArray(4);
+                glVertexAttribDivisor(4, 1);
+            } else {
+                // endpoints attribute, advancing once per instance
+                glBindBuffer(GL_ARRAY_BUFFER, edgeInstanceBuffer);
+                glVertexAttribIPointer(3, 2, GL_UNSIGNED_INT, 2 * sizeof(GLuint), (void*)0);
+                glEnableVertexAttribArray(3);
+                glVertexAttribDivisor(3, 1);
+            }
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    // Destroy per-instance graph buffers
+    void destroy_graph_buffers(void) {
+        if (numGraphNodes == 0 && numWires == 0) return;
+        glDeleteVertexArrays(1, &nodeVAO);
+        glDeleteVertexArrays(1, &edgeVAO);
+        glDeleteBuffers(1, &nodeInstanceBuffer);
+        glDeleteBuffers(1, &edgeInstanceBuffer);
+        glDeleteBuffers(1, &visibleNodeBuffer);
+        glDeleteBuffers(1, &visibleWireBuffer);
+        glDeleteBuffers(1, &positionBuffer);
+        glDeleteBuffers(1, &opinionBuffer);
+        glDeleteBuffers(OPINION_STAGING_SLOTS, opinionStaging);
+        for (int slot = 0; slot < OPINION_STAGING_SLOTS; ++slot) {
+            if (opinionFences[slot]) glDeleteSync(opinionFences[slot]);
+            opinionFences[slot] = 0;
+        }
+        glDeleteTextures(1, &positionTexture);
+        glDeleteTextures(1, &opinionTexture);
+        numGraphNodes = numWires = 0;
+    }
+
+    // Start patching opinions from the simulation's change ring (the worker must have been given one).
+    void follow_opinions(void) {
+        worker::init_follower(simulation, &opinionFollower);
+        bitset::resize(&opinionDirty, opinionFollower.opinion.words.size());
+        bitset::fill(&opinionDirty, false);
+        opinionDirtyWords = 0;
+        opinionStale = true;
+    }
+    // Upload the opinion words changed since the last upload. Each upload goes through the next staging buffer in the
+    // ring: dirty runs are written at their own offsets, then copied into the opinion buffer on the GPU. A staging
+    // buffer the GPU may still be reading is never waited on; its changes stay dirty until a later frame.
+    void upload_opinions(void) {
+        bool resynced = worker::follow(simulation, &opinionFollower, [](const OpinionChange& change) {
+            size_t word = change.node / 64;
+            if (bitset::get(&opinionDirty, word)) return;
+            bitset::set(&opinionDirty, word, true);
+            ++opinionDirtyWords;
+        });
+        if (resynced) opinionStale = true;
+        size_t numWords = opinionFollower.opinion.words.size();
+        if (numWords == 0 || opinionFollower.resyncing) return;
+        if (!opinionStale && opinionDirtyWords == 0) return;
+
+        GLsync* fence = &opinionFences[opinionSlot];
+        if (*fence) {
+            if (glClientWaitSync(*fence, 0, 0) == GL_TIMEOUT_EXPIRED) return;
+            glDeleteSync(*fence);
+            *fence = 0;
+        }
+
+        // collect runs of dirty words
+        opinionRuns.clear();
+        if (opinionStale) {
+            opinionRuns.push_back({ 0, numWords });
+        } else {
+            for (size_t i = 0; i < opinionDirty.words.size(); ++i) {
+                for (uint64_t bits = opinionDirty.words[i]; bits != 0; bits &= bits - 1) {
+                    size_t word = i * 64 + bitset::ctz(bits);
+                    if (!opinionRuns.empty() && word <= opinionRuns.back().second + OPINION_RUN_GAP)
+                        opinionRuns.back().second = word + 1;
+                    else
+                        opinionRuns.push_back({ word, word + 1 });
+                }
+            }
+        }
+
+        // the fence says the GPU is done with this staging buffer, so it can be written without synchronizing
+        size_t first = opinionRuns.front().first, last = opinionRuns.back().second;
+        glBindBuffer(GL_COPY_READ_BUFFER, opinionStaging[opinionSlot]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, opinionBuffer);
+        uint64_t* staging = (uint64_t*)glMapBufferRange(GL_COPY_READ_BUFFER, first * sizeof(uint64_t),
+            (last - first) * sizeof(uint64_t), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+        if (staging != NULL) {
+            const uint64_t* words = opinionFollower.opinion.words.data();
+            for (const auto& run : opinionRuns) {
+                std::copy(words + run.first, words + run.second, staging + (run.first - first));
+                glFlushMappedBufferRange(GL_COPY_READ_BUFFER, (run.first - first) * sizeof(uint64_t),
+                                         (run.second - run.first) * sizeof(uint64_t));
+            }
+            if (glUnmapBuffer(GL_COPY_READ_BUFFER)) {
+                for (const auto& run : opinionRuns)
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, run.first * sizeof(uint64_t),
+                                        run.first * sizeof(uint64_t), (run.second - run.first) * sizeof(uint64_t));
+                *fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                opinionSlot = (opinionSlot + 1) % OPINION_STAGING_SLOTS;
+                bitset::fill(&opinionDirty, false);
+                opinionDirtyWords = 0;
+                opinionStale = false;
+            }
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    void positions_changed(void) {
+        nodeGridStale = wireGridStale = true;
+    }
+    static void refresh_node_grid(void) {
+        if (!nodeGridStale) return;
+        spatial_grid::build(&nodeGrid, graph1->properties.x, graph1->properties.y, NODE_RADIUS);
+        nodeGridStale = false;
+    }
+    // A wire's bounding box lies within its half-extents of its midpoint, so the wires that can touch a rectangle
+    // are among those whose midpoints fall in the rectangle grown by the largest half-extents.
+    static void refresh_wire_grid(void) {
+        if (!wireGridStale) return;
+        const std::vector<float>& x = graph1->properties.x;
+        const std::vector<float>& y = graph1->properties.y;
+        size_t num_wires = wireEndpoints.size() / 2;
+        wireMidX.resize(num_wires);
+        wireMidY.resize(num_wires);
+        wireHalfX = wireHalfY = 0.f;
+        for (size_t w = 0; w < num_wires; ++w) {
+            GLuint u = wireEndpoints[2 * w], v = wireEndpoints[2 * w + 1];
+            wireMidX[w] = 0.5f * (x[u] + x[v]);
+            wireMidY[w] = 0.5f * (y[u] + y[v]);
+            wireHalfX = std::max(wireHalfX, 0.5f * fabsf(x[u] - x[v]));
+            wireHalfY = std::max(wireHalfY, 0.5f * fabsf(y[u] - y[v]));
+        }
+        spatial_grid::build(&wireGrid, wireMidX, wireMidY, NODE_RADIUS);
+        wireGridStale = false;
+    }
+    // Pick the node under a world position: the nearest one whose quad covers it.
+    uint pick(float x, float y) {
+        refresh_node_grid();
+        return spatial_grid::nearest(&nodeGrid, graph1->properties.x, graph1->properties.y, x, y, NODE_RADIUS);
+    }
+    // Collect the nodes and wires that can touch the world rectangle [x0, x1] x [y0, y1] into visibleNodes and
+    // visibleWires. Returns false without collecting anything if the whole graph is inside it.
+    static bool cull(float x0, float y0, float x1, float y1) {
+        refresh_node_grid();
+        const std::vector<float>& x = graph1->properties.x;
+        const std::vector<float>& y = graph1->properties.y;
+        // grow the view by the quads' extent, so anything partly visible is kept
+        x0 -= NODE_RADIUS; y0 -= NODE_RADIUS; x1 += NODE_RADIUS; y1 += NODE_RADIUS;
+        float gx1 = nodeGrid.x0 + nodeGrid.cell * nodeGrid.nx, gy1 = nodeGrid.y0 + nodeGrid.cell * nodeGrid.ny;
+        if (x0 <= nodeGrid.x0 && y0 <= nodeGrid.y0 && gx1 <= x1 && gy1 <= y1) return false;
+
+        visibleNodes.clear();
+        spatial_grid::query(&nodeGrid, x0, y0, x1, y1, [&](uint n) {
+            if (x0 <= x[n] && x[n] <= x1 && y0 <= y[n] && y[n] <= y1) visibleNodes.push_back(n);
+        });
+        // a wire can cross the view with both ends outside it, so test the bounding box of every wire whose midpoint
+        // is near enough for it to reach the view
+        refresh_wire_grid();
+        visibleWires.clear();
+        spatial_grid::query(&wireGrid, x0 - wireHalfX, y0 - wireHalfY, x1 + wireHalfX, y1 + wireHalfY, [&](uint w) {
+            GLuint u = wireEndpoints[2 * w], v = wireEndpoints[2 * w + 1];
+            if (std::max(x[u], x[v]) < x0 || std::min(x[u], x[v]) > x1) return;
+            if (std::max(y[u], y[v]) < y0 || std::min(y[u], y[v]) > y1) return;
+            visibleWires.push_back(u);
+            visibleWires.push_back(v);
+        });
+        return true;
+    }
+    // Point a VAO's per-instance attribute at `buffer`, after filling it with `data` if given.
+    static void set_instances(GLuint vao, GLuint attribute, GLint components, GLuint buffer,
+                              const std::vector<GLuint>* data) {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        if (data != NULL) {
+            glBufferData(GL_ARRAY_BUFFER, data->size() * sizeof(GLuint), NULL, GL_STREAM_DRAW);  // orphan
+            glBufferSubData(GL_ARRAY_BUFFER, 0, data->size() * sizeof(GLuint), data->data());
+        }
+        glVertexAttribIPointer(attribute, components, GL_UNSIGNED_INT, components * sizeof(GLuint), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
     // Load Texture
     void load_texture(const char* filename, GLuint* texture) {
         /* Load Node Texture */
@@ -244,13 +558,18 @@ namespace graphics {
         stbi_image_free(data);
     }
 
-    // Define Shader Texture Samplers
+    // Define Shader Texture Samplers (sampler uniforms are program state, so this is done once after linking)
     void set_textures(void) {
-        // Set Shader Uniforms */
-        // glUseProgram(shaderGraph);
-        // glUniform1i(glGetUniformLocation(shaderGraph, "textureNode"), 0);
-        // glUniform1i(glGetUniformLocation(shaderGraph, "textureEdge"), 1);
-        // glUniform1i(glGetUniformLocation(shaderGraph, "textureFont"), 2);
+        // loading binds programs and textures behind the state cache's back
+        program::invalidate(&glState);
+        // Set Shader Uniforms
+        program::use(&glState, &shaderGraph);
+        glUniform1i(program::uniform(&shaderGraph, "textureNode"), 0);
+        glUniform1i(program::uniform(&shaderGraph, "textureEdge"), 1);
+        glUniform1i(program::uniform(&shaderGraph, "positions"), 3);
+        glUniform1i(program::uniform(&shaderGraph, "opinions"), 4);
+        program::use(&glState, &shaderText);
+        glUniform1i(program::uniform(&shaderText, "textureFont"), 2);
     }
 
     // Display Scene
@@ -260,17 +579,10 @@ namespace graphics {
         glClear(GL_COLOR_BUFFER_BIT);
 
         // bind textures to texture units
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureNode);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textureEdge);
-        //glActiveTexture(GL_TEXTURE2);
-        //glBindTexture(GL_TEXTURE_2D, textureFont);
-        glUseProgram(shaderGraph);
-        glUniform1i(glGetUniformLocation(shaderGraph, "textureNode"), 0);
-        glUniform1i(glGetUniformLocation(shaderGraph, "textureEdge"), 1);
-        //glUniform1i(glGetUniformLocation(shaderGraph, "textureFont"), 2);
+        program::bind_texture(&glState, 0, GL_TEXTURE_2D, textureNode);
+        program::bind_texture(&glState, 1, GL_TEXTURE_2D, textureEdge);
         // activate shader
+        program::use(&glState, &shaderGraph);
         // transformation matrices
         glm::mat4 view  = glm::mat4(1.0f);
         glm::mat4 proj  = glm::mat4(1.0f);
@@ -280,83 +592,64 @@ namespace graphics {
         proj = glm::ortho(-zoom*aspect, zoom*aspect, -zoom, zoom, 0.1f, 100.0f);
         //proj = glm::perspective(glm::radians(45.0f), (float)scr_width/(float)scr_height, 0.1f, 100.f);
         // get their uniform locations
-        GLuint viewLoc = glGetUniformLocation(shaderGraph, "view");
-        GLuint projLoc = glGetUniformLocation(shaderGraph, "proj");
+        GLint viewLoc = program::uniform(&shaderGraph, "view");
+        GLint projLoc = program::uniform(&shaderGraph, "proj");
         // pass to shaders
         glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
         glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(proj));
 
-        GLuint selectLoc = glGetUniformLocation(shaderGraph, "texSelection");
-
-        // bind vertices of unit quad (+/-1,+/-1)
-        glBindVertexArray(VAO);
+        GLint selectLoc = program::uniform(&shaderGraph, "texSelection");
+
+        // upload this frame's positions (x column, then y column) and the opinions that changed since the last frame
+        size_t columnBytes = (size_t)numGraphNodes * sizeof(GLfloat);
+        glBindBuffer(GL_TEXTURE_BUFFER, positionBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, 2 * columnBytes, NULL, GL_STREAM_DRAW);  // orphan last frame's storage
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, columnBytes, graph1->properties.x.data());
+        glBufferSubData(GL_TEXTURE_BUFFER, columnBytes, columnBytes, graph1->properties.y.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        upload_opinions();
+
+        // bind buffer textures
+        program::bind_texture(&glState, 3, GL_TEXTURE_BUFFER, positionTexture);
+        program::bind_texture(&glState, 4, GL_TEXTURE_BUFFER, opinionTexture);
+        glUniform1i(program::uniform(&shaderGraph, "numNodes"), numGraphNodes);
+        glUniform1i(program::uniform(&shaderGraph, "selectedNode"), nodeSelected ? (GLint)selectedNode : -1);
+        glm::vec3 highlight{ 1.0f, 1.0f, 1.0f };
+        glUniform3fv(program::uniform(&shaderGraph, "highlight"), 1, glm::value_ptr(highlight));
+
+        // cull what is off-screen, unless the whole graph is in view
+        GLsizei drawnWires = numWires, drawnNodes = numGraphNodes;
+        if (cull(camera.pos.x - zoom*aspect, camera.pos.y - zoom, camera.pos.x + zoom*aspect, camera.pos.y + zoom)) {
+            drawnWires = (GLsizei)(visibleWires.size() / 2);
+            drawnNodes = (GLsizei)visibleNodes.size();
+            set_instances(edgeVAO, 3, 2, visibleWireBuffer, &visibleWires);
+            set_instances(nodeVAO, 4, 1, visibleNodeBuffer, &visibleNodes);
+        } else {
+            set_instances(edgeVAO, 3, 2, edgeInstanceBuffer, NULL);
+            set_instances(nodeVAO, 4, 1, nodeInstanceBuffer, NULL);
+        }
 
-        // Render wires
+        // Render wires (one instance per wire)
         GLint selection = 2;
         glUniform1i(selectLoc, selection);
-        for(const auto& elem: graph1->edges) {
-            auto node1 = graph1->nodes[elem.first];
-            auto node2 = graph1->nodes[elem.second];
-            float x1 = node1->properties->x;
-            float y1 = node1->properties->y;
-            float x2 = node2->properties->x;
-            float y2 = node2->properties->y;
-            float dist = sqrt((x2-x1)*(x2-x1) + (y2-y1)*(y2-y1));
-            // set model matrix
-            glm::mat4 model = glm::mat4(1.0f);
-            glm::vec3 edgePosition{ (x1+x2)/2.f, (y1+y2)/2.f, 0.f };
-            float theta = atan((y2-y1)/(x2-x1));
-            model = glm::translate(model, edgePosition);
-            model = glm::rotate(model, theta, glm::vec3(0.f,0.f,1.f));
-            model = glm::scale(model, glm::vec3(dist/2.f, 1.f, 1.f));
-            GLuint modelLoc = glGetUniformLocation(shaderGraph, "model");
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-            // draw edge
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        }
+        glBindVertexArray(edgeVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, drawnWires);
 
-        // Render Nodes
+        // Render Nodes (one instance per node)
         selection = 1;
         glUniform1i(selectLoc, selection);
-        for (uint n = 0; n < graph1->nodes.size(); ++n) {
-            // set model matrix
-            glm::mat4 model = glm::mat4(1.0f);
-            glm::vec3 nodePosition{ graph1->nodes[n]->properties->x, graph1->nodes[n]->properties->y, 0.0f };
-            model = glm::translate(model, nodePosition);
-            GLuint modelLoc = glGetUniformLocation(shaderGraph, "model");
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-            // set color
-            GLuint colorLoc = glGetUniformLocation(shaderGraph, "nodeColor");
-            glm::vec3 green{ 0.0f, 1.0f, 0.0f };
-            glm::vec3 red{ 1.0f, 0.0f, 0.0f };
-            glm::vec3 nodeColor = (graph1->nodes[n]->properties->opinion)?green:red;
-            glUniform3fv(colorLoc, 1, glm::value_ptr(nodeColor));
-            // highlight if selected node
-            GLuint selLoc  = glGetUniformLocation(shaderGraph, "selected");
-            int sel{ 0 };
-            if (nodeSelected && selectedNode == n) {
-                sel = 1;
-                GLuint highlightLoc = glGetUniformLocation(shaderGraph, "highlight");
-                glm::vec3 highlight{ 1.0f, 1.0f, 1.0f };
-                glUniform1i(selLoc, sel);
-                glUniform3fv(highlightLoc, 1, glm::value_ptr(highlight));
-            } else {
-                sel = 0;
-                glUniform1i(selLoc, sel);
-            }
-            // draw node
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        }
+        glBindVertexArray(nodeVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, drawnNodes);
+
+        // the text overlay draws single quads
+        glBindVertexArray(VAO);
 
         // Optional: Draw Dev Readout
         if(!devmode) return;
-        glUseProgram(shaderText);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, textureFont);
-        glUniform1i(glGetUniformLocation(shaderText, "textureFont"), 2);
-        GLuint coordLoc = glGetUniformLocation(shaderText, "charCoords");
-        glm::mat4 model = glm::mat4(1.0f);
-        GLuint modelLoc = glGetUniformLocation(shaderText, "model");
+        program::use(&glState, &shaderText);
+        program::bind_texture(&glState, 2, GL_TEXTURE_2D, textureFont);
+        GLint coordLoc = program::uniform(&shaderText, "charCoords");
+        GLint modelLoc = program::uniform(&shaderText, "model");
         // Draw "FPS:_"
         char digits[15];
         int len = sprintf(digits, "FPS: %6.1f", fps);
@@ -368,7 +661,6 @@ namespace graphics {
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::scale(model, scaling);
             model = glm::translate(model, margin+glm::vec3((float)(n), 0.f, 0.f));
-            GLuint modelLoc = glGetUniformLocation(shaderText, "model");
             glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
             glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
         }
@@ -383,7 +675,6 @@ namespace graphics {
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::scale(model, scaling);
             model = glm::translate(model, margin+glm::vec3((float)(n), 0.f, 0.f));
-            GLuint modelLoc = glGetUniformLocation(shaderText, "model");
             glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
             glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
         }
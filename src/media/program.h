@@ -0,0 +1,135 @@
+#ifndef PROGRAM_H
+
+// OpenGL
+#include <glad/glad.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <string>
+#include <unordered_map>
+
+/*
+Linked shader programs with their uniform and attribute locations resolved once, at link time, so drawing code never
+asks the driver to look a name up. Alongside, a small cache of bound GL state that skips redundant glUseProgram,
+glActiveTexture and glBindTexture calls.
+
+Code that binds programs or textures behind the cache's back must call invalidate before the cache is used again.
+*/
+namespace program {
+    //// Types
+    typedef struct program Program;
+    typedef struct state_cache StateCache;
+
+    #define PROGRAM_MAX_TEXTURE_UNITS 16
+    #define PROGRAM_UNKNOWN 0xFFFFFFFFu   // cached state that has to be set before it can be trusted
+
+    //// forward declarations
+    // structs
+    struct program;
+    struct state_cache;
+
+    // functions
+    void reflect(Program*, GLuint);
+    GLint uniform(const Program*, const char*);
+    GLint attribute(const Program*, const char*);
+    void destroy(Program*);
+    void invalidate(StateCache*);
+    void use(StateCache*, const Program*);
+    void bind_texture(StateCache*, GLuint, GLenum, GLuint);
+
+
+    //// Implementations
+    struct program {
+        GLuint id{ 0 };
+        std::unordered_map<std::string, GLint> uniforms;
+        std::unordered_map<std::string, GLint> attributes;
+    };
+
+    struct state_cache {
+        GLuint program;
+        GLuint activeUnit;
+        GLenum targets[PROGRAM_MAX_TEXTURE_UNITS];
+        GLuint textures[PROGRAM_MAX_TEXTURE_UNITS];
+    };
+
+    // Take ownership of a linked program and record the locations of all its active uniforms and attributes.
+    void reflect(Program* program, GLuint id) {
+        program->id = id;
+        program->uniforms.clear();
+        program->attributes.clear();
+
+        GLint count, maxLength;
+        GLchar name[256];
+        GLint size;
+        GLenum type;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        for (GLint i = 0; i < count; ++i) {
+            glGetActiveUniform(id, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+            // arrays are reported as "name[0]"; record them under their plain name
+            char* bracket = strchr(name, '[');
+            if (bracket != NULL) *bracket = '\0';
+            program->uniforms[name] = glGetUniformLocation(id, name);
+        }
+        glGetProgramiv(id, GL_ACTIVE_ATTRIBUTES, &count);
+        for (GLint i = 0; i < count; ++i) {
+            glGetActiveAttrib(id, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+            program->attributes[name] = glGetAttribLocation(id, name);
+        }
+        if (maxLength > (GLint)sizeof(name))
+            fprintf(stderr, "(OpenGL) Warning, uniform names longer than %zu characters are truncated.\n", sizeof(name));
+    }
+
+    // Location of a uniform, or -1 if the program has no such active uniform (glUniform* ignores -1).
+    GLint uniform(const Program* program, const char* name) {
+        auto it = program->uniforms.find(name);
+        return (it == program->uniforms.end()) ? -1 : it->second;
+    }
+
+    // Location of a vertex attribute, or -1 if the program has no such active attribute.
+    GLint attribute(const Program* program, const char* name) {
+        auto it = program->attributes.find(name);
+        return (it == program->attributes.end()) ? -1 : it->second;
+    }
+
+    void destroy(Program* program) {
+        glDeleteProgram(program->id);
+        program->id = 0;
+        program->uniforms.clear();
+        program->attributes.clear();
+    }
+
+    // Forget all cached state, so the next use/bind_texture calls go through to GL.
+    void invalidate(StateCache* cache) {
+        cache->program = PROGRAM_UNKNOWN;
+        cache->activeUnit = PROGRAM_UNKNOWN;
+        for (int unit = 0; unit < PROGRAM_MAX_TEXTURE_UNITS; ++unit) {
+            cache->targets[unit] = GL_NONE;
+            cache->textures[unit] = PROGRAM_UNKNOWN;
+        }
+    }
+
+    void use(StateCache* cache, const Program* program) {
+        if (cache->program == program->id) return;
+        glUseProgram(program->id);
+        cache->program = program->id;
+    }
+
+    // Bind `texture` to `target` on texture unit `unit`, switching the active unit only when something changes.
+    // Each unit remembers one (target, texture) pair; binding another target on the same unit just rebinds later.
+    void bind_texture(StateCache* cache, GLuint unit, GLenum target, GLuint texture) {
+        assert( unit < PROGRAM_MAX_TEXTURE_UNITS );
+        if (cache->targets[unit] == target && cache->textures[unit] == texture) return;
+        if (cache->activeUnit != unit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            cache->activeUnit = unit;
+        }
+        glBindTexture(target, texture);
+        cache->targets[unit] = target;
+        cache->textures[unit] = texture;
+    }
+}
+
+#define PROGRAM_H
+#endif
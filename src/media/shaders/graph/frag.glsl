@@ -3,6 +3,9 @@ out vec4 FragColor;
 
 in vec3 ourColor;
 in vec2 TexCoord;
+// node color and selection, per instance
+flat in vec3 nodeColor;
+flat in int selected;
 
 // texture sampler
 uniform sampler2D textureNode;     // Node
@@ -11,13 +14,9 @@ uniform sampler2D textureEdge;     // Edge
 // texture selection
 uniform int texSelection;
 
-// node selection
-uniform int selected;
+// node selection highlight
 uniform vec3 highlight;
 
-// node color
-uniform vec3 nodeColor;
-
 void main()
 {
     vec2 uv = TexCoord;
@@ -38,4 +37,4 @@ void main()
         TexColor = texture(textureEdge, uv);
     }
     FragColor = TexColor;
-}
\ No newline at end of file
+}
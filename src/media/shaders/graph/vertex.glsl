@@ -2,17 +2,58 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
+// per-instance (edges only): node ids of the edge's endpoints
+layout (location = 3) in uvec2 aEndpoints;
+// per-instance (nodes only): node id
+layout (location = 4) in uint aNode;
 
 out vec3 ourColor;
 out vec2 TexCoord;
+flat out vec3 nodeColor;
+flat out int selected;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 proj;
 
+// texture selection: 1 draws nodes (one instance per drawn node), 2 draws wires (one instance per drawn edge)
+uniform int texSelection;
+
+// node positions: x of every node, then y of every node
+uniform samplerBuffer positions;
+uniform int numNodes;
+// node opinions: packed bitset, 32 nodes per texel
+uniform usamplerBuffer opinions;
+// selected node, or -1
+uniform int selectedNode;
+
+vec2 node_position(int n)
+{
+    return vec2(texelFetch(positions, n).r, texelFetch(positions, numNodes + n).r);
+}
+
 void main()
 {
-    gl_Position = proj * view * model * vec4(aPos, 1.0);
+    vec2 world;
+    if (texSelection == 2) {
+        // stretch the unit quad from one endpoint to the other, one unit thick
+        vec2 p1 = node_position(int(aEndpoints.x));
+        vec2 p2 = node_position(int(aEndpoints.y));
+        vec2 d = p2 - p1;
+        float len = length(d);
+        vec2 along = (len > 0.0) ? d / len : vec2(1.0, 0.0);
+        vec2 across = vec2(-along.y, along.x);
+        world = 0.5 * (p1 + p2) + along * (aPos.x * 0.5 * len) + across * aPos.y;
+        nodeColor = vec3(0.0);
+        selected = 0;
+    } else {
+        int n = int(aNode);
+        world = node_position(n) + aPos.xy;
+        uint word = texelFetch(opinions, n >> 5).r;
+        bool opinion = ((word >> uint(n & 31)) & 1u) != 0u;
+        nodeColor = opinion ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+        selected = (n == selectedNode) ? 1 : 0;
+    }
+    gl_Position = proj * view * vec4(world, 0.0, 1.0);
     ourColor = aColor;
     TexCoord = vec2(aTexCoord.x, aTexCoord.y);
-}
\ No newline at end of file
+}
@@ -1,13 +1,140 @@
+/*
+Random numbers: a counter-based generator (Philox4x32-10, Salmon et al. 2011) and the streams derived from it.
+
+A Philox output is a pure function of a key and a counter: the key is the master seed, the upper half of the counter
+names a stream and the lower half is the position within it. Any number of streams can be made from one master seed,
+in any order and on any thread, without them overlapping or depending on each other, and any stream can be rebuilt
+later from (master, id) alone. Code that runs in parallel takes a stream of its own instead of sharing one generator,
+so results are the same whatever the number of threads, and a single replica can be replayed by its stream id.
+
+`generator` is the stream for single-threaded code (setup, the default argument of the sampling functions). It comes
+from a random master seed unless rng::seed is called, and must only be used from one thread at a time.
+*/
 #ifndef RANDOM
 #define RANDOM
 
 
+#include <stdint.h>
 #include <random>
 
+#include "types.h"
+
+// Named streams, all with the top bit set; ids below RNG_STREAM_NAMED are free for numbered streams such as ensemble
+// replicas (see ensemble::stream_id).
+#define RNG_STREAM_NAMED ((uint64_t) 1 << 63)
+#define RNG_STREAM_MAIN (RNG_STREAM_NAMED | 0)
+#define RNG_STREAM_WORKER (RNG_STREAM_NAMED | 1)
+
 namespace rng {
+    //// Types
+    typedef struct philox Philox;
+
+    //// forward declarations
+    // structs
+    struct philox;
+
+    // functions
+    Philox stream(uint64_t, uint64_t);
+    inline void skip(Philox*, uint64_t);
+    void seed(uint64_t);
+    inline uint64_t master_seed();
+
+
+    //// Implementations
+    // Philox4x32-10 as a UniformRandomBitGenerator of 64-bit values; each counter value gives two of them.
+    struct philox {
+        typedef uint64_t result_type;
+
+        uint32_t key[2];
+        uint64_t id;        // upper half of the counter
+        uint64_t position;  // lower half of the counter: the next block to generate
+        uint64_t block[2];  // current block
+        uint used;          // values of `block` already returned
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT64_MAX; }
+
+        // The block at counter (id, position), as four 32-bit words packed into two 64-bit values.
+        void
+        generate() {
+            uint32_t c[4] = { (uint32_t) position, (uint32_t) (position >> 32), (uint32_t) id, (uint32_t) (id >> 32) };
+            uint32_t k0 = key[0], k1 = key[1];
+            for (int round = 0; round < 10; ++round) {
+                uint64_t p0 = (uint64_t) 0xD2511F53u * c[0];
+                uint64_t p1 = (uint64_t) 0xCD9E8D57u * c[2];
+                uint32_t next[4] = {
+                    (uint32_t) (p1 >> 32) ^ c[1] ^ k0, (uint32_t) p1,
+                    (uint32_t) (p0 >> 32) ^ c[3] ^ k1, (uint32_t) p0 };
+                c[0] = next[0]; c[1] = next[1]; c[2] = next[2]; c[3] = next[3];
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+            block[0] = ((uint64_t) c[1] << 32) | c[0];
+            block[1] = ((uint64_t) c[3] << 32) | c[2];
+            position++;
+            used = 0;
+        }
+
+        result_type
+        operator()() {
+            if (used == 2) generate();
+            return block[used++];
+        }
+
+        // For code written against the standard engines: restart as the main stream of master seed `value`.
+        void
+        seed(result_type value) {
+            *this = stream(value, RNG_STREAM_MAIN);
+        }
+    };
+
+    // Stream `id` of master seed `master`, from its start.
+    Philox
+    stream(uint64_t master, uint64_t id) {
+        Philox gen;
+        gen.key[0] = (uint32_t) master;
+        gen.key[1] = (uint32_t) (master >> 32);
+        gen.id = id;
+        gen.position = 0;
+        gen.block[0] = gen.block[1] = 0;
+        gen.used = 2;
+        return gen;
+    }
+
+    // Move `count` values ahead in O(1).
+    inline void
+    skip(Philox* gen, uint64_t count) {
+        // index of the next value in the stream; while a block is in use it is the one before `position`
+        uint64_t next = (gen->used == 2) ? 2 * gen->position : 2 * (gen->position - 1) + gen->used;
+        uint64_t target = next + count;
+        gen->position = target / 2;
+        gen->used = 2;
+        if (target % 2 != 0) {
+            gen->generate();
+            gen->used = 1;
+        }
+    }
+
+    inline uint64_t
+    random_master() {
+        std::random_device device;
+        return ((uint64_t) device() << 32) | device();
+    }
+
+    inline uint64_t master = random_master();
+    inline Philox generator = stream(master, RNG_STREAM_MAIN);
+
+    // Make every stream, `generator` included, a function of `value`.
+    void
+    seed(uint64_t value) {
+        master = value;
+        generator = stream(master, RNG_STREAM_MAIN);
+    }
 
-    static std::random_device random_device;
-    extern std::default_random_engine generator(random_device());
+    inline uint64_t
+    master_seed() {
+        return master;
+    }
 
 } // end namespace
 
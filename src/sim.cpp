@@ -0,0 +1,285 @@
+// Headless simulation driver: runs a scenario's dynamics as fast as the CPU allows, with no window or audio.
+//
+//     opinion-sim [scenario.json] [--steps N] [--seed S] [--max-seconds T] [--quiet]
+//     opinion-sim scenario.json... --replicas R [--threads T] [--results results.csv] [--steps N] [--seed S]
+//
+// Prints throughput (steps/sec) and, for runs that go to consensus, the time taken to reach it.
+// With the scenario's "sampler" set to active_links, steps where nothing would change are skipped over in bulk, and
+// consensus is detected at the exact step it is reached. With "gillespie", each step is one event of a continuous-time
+// run, and the physical time reached is printed too.
+//
+// With --replicas, each scenario given is one point of a sweep: its graph is built once and R replicas with their own
+// random opinions and random streams run on it, spread over T threads (default: all cores). Each replica's result is
+// appended to the results CSV as it finishes, and a summary per point is printed at the end. Scenario outputs and
+// samplers are ignored in this mode.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "random.h"  // rng::
+#include "data_structures/graph.h"
+#include "data_structures/csr.h"
+#include "data_structures/builder.h"  // graph::default_num_threads
+#include "dynamics/utils.h"
+#include "dynamics/ensemble.h"
+#include "io/scenario.h"
+
+// Consensus is checked every max(1, num_nodes / SIM_CHECK_DIVISOR) steps, so that the popcount over the opinion
+// bitset (num_nodes / 64 words) costs O(1) per step on average.
+#define SIM_CHECK_DIVISOR (64)
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [scenario.json] [--steps N] [--seed S] [--max-seconds T] [--quiet]\n", name);
+    fprintf(stderr, "       %s scenario.json... --replicas R [--threads T] [--results results.csv] [--steps N] "
+        "[--seed S]\n", name);
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Run `replicas` replicas of each scenario's model on its graph, and report per point. Returns the exit status.
+static int run_ensemble(std::vector<io::Scenario>& scenarios, uint replicas, uint num_threads, const char* results_path,
+                        bool has_seed, uint64_t seed, bool quiet) {
+    // replica streams come from this seed; graphs from their scenario's seed, if it has one
+    if (! has_seed) seed = rng::master_seed();
+
+    std::vector<ensemble::Point> points;
+    for (auto& scenario : scenarios) {
+        graph::Graph* graph = io::make_graph(&scenario);
+        if (graph == nullptr) return EXIT_FAILURE;
+        ensemble::Point point;
+        point.topology = graph::freeze(graph);
+        graph::destroy(graph);
+        point.rule = step_sznajd_dynamics;
+        if (scenario.model == io::MODEL_VOTER) point.rule = step_voter_dynamics;
+        point.max_steps = scenario.steps;
+        point.replicas = replicas;
+        points.push_back(point);
+    }
+
+    FILE* results = nullptr;
+    if (results_path != nullptr) {
+        results = fopen(results_path, "w");
+        if (results == nullptr) {
+            fprintf(stderr, "(io) Could not open %s for writing\n", results_path);
+            return EXIT_FAILURE;
+        }
+        fprintf(results, "point,replica,steps,consensus,magnetization\n");
+    }
+
+    std::vector<ensemble::Summary> summaries(points.size());
+    thread_pool::Pool* pool = thread_pool::make(num_threads);
+    auto start = std::chrono::steady_clock::now();
+    ensemble::run(pool, points, seed, [&](const ensemble::Result& result) {
+        ensemble::add(&summaries[result.point], result);
+        if (results != nullptr) {
+            fprintf(results, "%u,%u,%llu,%d,%.6f\n", result.point, result.replica, (unsigned long long) result.steps,
+                (int) result.consensus, result.magnetization);
+        }
+    });
+    double run_seconds = seconds_since(start);
+    thread_pool::destroy(pool);
+    if (results != nullptr) fclose(results);
+
+    double total_steps = 0.;
+    for (uint p = 0; p < points.size(); ++p) {
+        const ensemble::Summary& summary = summaries[p];
+        total_steps += summary.mean_steps * (double) summary.count;
+        if (quiet) {
+            printf("%u %llu %llu %.1f %.1f %.6f\n", p, (unsigned long long) summary.count,
+                (unsigned long long) summary.consensus, summary.mean_steps, ensemble::stddev_steps(&summary),
+                summary.mean_abs_magnetization);
+        } else {
+            printf("point %u: %u nodes, %llu of %llu replicas reached consensus, steps %.1f +- %.1f, |m| %.4f\n", p,
+                points[p].topology->num_nodes, (unsigned long long) summary.consensus,
+                (unsigned long long) summary.count, summary.mean_steps, ensemble::stddev_steps(&summary),
+                summary.mean_abs_magnetization);
+        }
+        graph::destroy((graph::CSR*) points[p].topology);
+    }
+    if (! quiet) {
+        printf("ensemble: %.0f steps in %.3f s on %u threads (%.0f steps/sec), seed %llu\n", total_steps, run_seconds,
+            num_threads, (run_seconds > 0.) ? total_steps / run_seconds : 0., (unsigned long long) seed);
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    io::Scenario scenario = io::default_scenario();
+    bool has_steps = false, has_seed = false, quiet = false;
+    uint64_t steps_override = 0, seed_override = 0;
+    double max_seconds = 0.;
+    uint replicas = 0, num_threads = graph::default_num_threads();
+    const char* results_path = nullptr;
+    std::vector<const char*> paths;
+
+    // parse arguments: scenario paths (one, unless running replicas) plus flags, in any order
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if (strcmp(arg, "--steps") == 0 && has_value) {
+            has_steps = true;
+            steps_override = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--seed") == 0 && has_value) {
+            has_seed = true;
+            seed_override = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--max-seconds") == 0 && has_value) {
+            max_seconds = strtod(argv[++i], nullptr);
+        } else if (strcmp(arg, "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(arg, "--replicas") == 0 && has_value) {
+            replicas = (uint) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--threads") == 0 && has_value) {
+            num_threads = (uint) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--results") == 0 && has_value) {
+            results_path = argv[++i];
+        } else if (arg[0] != '-') {
+            paths.push_back(arg);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (paths.size() > 1 && replicas == 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (replicas > 0) {
+        // the seed given on the command line drives the replicas; scenario seeds still fix their graphs
+        std::vector<io::Scenario> scenarios;
+        for (const char* path : paths) {
+            scenarios.push_back(io::default_scenario());
+            if (! io::load_scenario(path, &scenarios.back())) return EXIT_FAILURE;
+        }
+        if (scenarios.empty()) scenarios.push_back(scenario);
+        if (has_steps) {
+            for (auto& point : scenarios) point.steps = steps_override;
+        }
+        return run_ensemble(scenarios, replicas, std::max(num_threads, 1u), results_path, has_seed, seed_override,
+            quiet);
+    }
+    if (! paths.empty() && ! io::load_scenario(paths[0], &scenario)) return EXIT_FAILURE;
+    if (has_steps) scenario.steps = steps_override;
+    if (has_seed) {
+        scenario.has_seed = true;
+        scenario.seed = seed_override;
+    }
+
+    // set up
+    auto start = std::chrono::steady_clock::now();
+    graph::Graph* graph = io::make_graph(&scenario);
+    if (graph == nullptr) return EXIT_FAILURE;
+    double setup_seconds = seconds_since(start);
+    if (! quiet) {
+        printf("graph: %zu nodes, %zu edges (%.3f s)\n", graph->nodes.size(), graph->edges.size(), setup_seconds);
+    }
+
+    // run
+    uint64_t check_interval = graph->nodes.size() / SIM_CHECK_DIVISOR;
+    if (check_interval == 0) check_interval = 1;
+    bool to_consensus = (scenario.steps == 0);
+    bool timed_out = false;
+    uint64_t steps = 0;
+    active_links::Engine* engine = io::make_engine(&scenario, graph);
+    gillespie::Engine* clock = io::make_clock(&scenario, graph);
+    if (scenario.sampler == io::SAMPLER_GILLESPIE && clock == nullptr) {
+        graph::destroy(graph);
+        return EXIT_FAILURE;
+    }
+    start = std::chrono::steady_clock::now();
+    if (clock != nullptr) {
+        // events in batches of check_interval, stopping where outputs are due; with every rate 0 nothing more can
+        // happen and the run ends
+        uint64_t limit = to_consensus ? UINT64_MAX : scenario.steps;
+        while (! io::is_finished(&scenario, graph, clock->events) && gillespie::total_rate(clock) > 0.) {
+            uint64_t target = std::min(limit, io::next_output_step(&scenario, clock->events));
+            gillespie::advance(clock, std::min(target, clock->events + check_interval));
+            io::write_outputs(&scenario, graph, clock->events, false);
+            if (max_seconds > 0. && seconds_since(start) > max_seconds) {
+                timed_out = true;
+                break;
+            }
+        }
+        steps = clock->events;
+    } else if (engine != nullptr) {
+        // jump from change to change, stopping where outputs are due; the clock is checked every check_interval
+        // changes. Without active edges nothing can change again, which for a run to consensus ends it.
+        uint64_t limit = to_consensus ? UINT64_MAX : scenario.steps;
+        while (to_consensus ? active_links::num_active(engine) > 0 : engine->steps < limit) {
+            uint64_t target = std::min(limit, io::next_output_step(&scenario, engine->steps));
+            // when frozen, every step before target is a no-op
+            if (active_links::num_active(engine) == 0) engine->steps = target;
+            else active_links::advance(engine, target, check_interval);
+            io::write_outputs(&scenario, graph, engine->steps, false);
+            if (max_seconds > 0. && seconds_since(start) > max_seconds) {
+                timed_out = true;
+                break;
+            }
+        }
+        steps = engine->steps;
+    } else if (to_consensus) {
+        while (! io::is_finished(&scenario, graph, steps)) {
+            for (uint64_t i = 0; i < check_interval; ++i) {
+                io::step(&scenario, graph);
+                io::write_outputs(&scenario, graph, ++steps, false);
+            }
+            if (max_seconds > 0. && seconds_since(start) > max_seconds) {
+                timed_out = true;
+                break;
+            }
+        }
+    } else {
+        for (; steps < scenario.steps; ) {
+            io::step(&scenario, graph);
+            io::write_outputs(&scenario, graph, ++steps, false);
+            if (max_seconds > 0. && steps % check_interval == 0 && seconds_since(start) > max_seconds) {
+                timed_out = true;
+                break;
+            }
+        }
+    }
+    double run_seconds = seconds_since(start);
+    io::write_outputs(&scenario, graph, steps, true);
+    io::close_outputs(&scenario);
+
+    // report
+    auto histogram = opinion_histogram(graph);
+    bool consensus = is_consensus_reached(graph);
+    double rate = (run_seconds > 0.) ? (double) steps / run_seconds : 0.;
+    if (quiet) {
+        printf("%llu %.6f %.1f %d %u %u\n", (unsigned long long) steps, run_seconds, rate, (int) consensus,
+            histogram.first, histogram.second);
+    } else {
+        printf("steps: %llu in %.3f s (%.0f steps/sec)\n", (unsigned long long) steps, run_seconds, rate);
+        printf("opinions: %u false, %u true\n", histogram.first, histogram.second);
+        if (clock != nullptr) printf("time: %.6g\n", clock->time);
+        printf("seed: %llu (replay with --seed)\n", (unsigned long long) rng::master_seed());
+        if (to_consensus && ! timed_out && engine != nullptr) {
+            if (consensus) {
+                printf("consensus: reached at step %llu, %.3f s\n", (unsigned long long) steps, run_seconds);
+            } else {
+                printf("consensus: not reached, no step can change an opinion after step %llu\n",
+                    (unsigned long long) steps);
+            }
+        } else if (to_consensus && ! timed_out) {
+            printf("consensus: reached within %llu steps (checked every %llu), %.3f s\n",
+                (unsigned long long) steps, (unsigned long long) check_interval, run_seconds);
+        } else if (timed_out) {
+            printf("consensus: %s, stopped after %.0f s\n", consensus ? "reached" : "not reached", max_seconds);
+        } else {
+            printf("consensus: %s\n", consensus ? "reached" : "not reached");
+        }
+    }
+
+    if (engine != nullptr) active_links::destroy(engine);
+    if (clock != nullptr) gillespie::destroy(clock);
+    graph::destroy(graph);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+
+#include "../types.h"
+#include "../random.h"
+#include "../data_structures/graph.h"
+#include "../generators/erdos_renyi.h"
+#include "../generators/barabasi_albert.h"
+#include "../generators/lattice.h"
+#include "../generators/watts_strogatz.h"
+#include "../generators/stochastic_block_model.h"
+#include "../generators/layout.h"
+#include "../algorithms/force_layout.h"
+
+#define TEST_SIZE (2000)
+
+// Every edge must be in range, not a self-loop, and (for undirected graphs) present in both directions.
+static void check_simple(const graph::Graph* graph, bool directed) {
+    for (auto edge : graph->edges) {
+        assert( edge.first < graph->nodes.size() && edge.second < graph->nodes.size() );
+        assert( edge.first != edge.second );
+        if (! directed) assert( graph::has_edge(graph, edge.second, edge.first) );
+    }
+}
+
+int main(void) {
+    // G(n, p): edge count should be within a few standard deviations of its mean
+    printf("Checking G(n, p)...\n");
+    double p = 0.01;
+    for (int directed = 0; directed < 2; ++directed) {
+        graph::Graph* graph = generators::erdos_renyi(TEST_SIZE, p, directed);
+        double pairs = (double) generators::num_pairs(TEST_SIZE, directed);
+        double mean = pairs * p;
+        double num_edges = directed ? graph->edges.size() : graph->edges.size() / 2;
+        printf("\tdirected=%i edges=%.0f expected=%.0f\n", directed, num_edges, mean);
+        assert( fabs(num_edges - mean) < 5. * sqrt(mean * (1. - p)) );
+        check_simple(graph, directed);
+        graph::destroy(graph);
+    }
+
+    // G(n, m): exact edge count, sparse and dense
+    printf("Checking G(n, m)...\n");
+    for (int directed = 0; directed < 2; ++directed) {
+        uint64_t pairs = generators::num_pairs(64, directed);
+        for (uint64_t m : { (uint64_t) 100, pairs - 10 }) {
+            graph::Graph* graph = generators::erdos_renyi_m(64, m, directed);
+            assert( graph->edges.size() == (directed ? m : 2 * m) );
+            check_simple(graph, directed);
+            graph::destroy(graph);
+        }
+    }
+
+    // pair enumeration must be a bijection
+    printf("Checking pair enumeration...\n");
+    for (int directed = 0; directed < 2; ++directed) {
+        graph::Graph* graph = generators::erdos_renyi(50, 1., directed);
+        assert( graph->edges.size() == 50 * 49 );
+        check_simple(graph, directed);
+        graph::destroy(graph);
+    }
+
+    // Barabási–Albert: exact edge count, every late node has degree >= m, and hubs emerge
+    printf("Checking Barabasi-Albert...\n");
+    {
+        uint m = 3;
+        graph::Graph* graph = generators::barabasi_albert(TEST_SIZE, m);
+        assert( graph->edges.size() == 2 * (size_t) m * (TEST_SIZE - m) );
+        check_simple(graph, false);
+        int max_degree = 0;
+        for (uint n = m; n < TEST_SIZE; ++n) {
+            assert( graph::degree(graph, n) >= (int) m );
+            max_degree = std::max(max_degree, graph::degree(graph, n));
+        }
+        printf("\tmax degree=%i\n", max_degree);
+        assert( max_degree > 10 * (int) m );
+        graph::destroy(graph);
+    }
+
+    // lattices: every node has full degree, and small periodic axes do not create duplicates
+    printf("Checking lattices...\n");
+    {
+        graph::Graph* graph = generators::ring_lattice(100, 3);
+        assert( graph->edges.size() == 100 * 6 );
+        check_simple(graph, false);
+        assert( graph::has_edge(graph, 0, 99) && graph::has_edge(graph, 0, 3) && ! graph::has_edge(graph, 0, 4) );
+        graph::destroy(graph);
+
+        graph = generators::lattice_2d(10, 20);
+        assert( graph->edges.size() == 200 * 4 );
+        check_simple(graph, false);
+        assert( graph::has_edge(graph, 0, 19) && graph::has_edge(graph, 0, 180) );
+        graph::destroy(graph);
+
+        graph = generators::lattice_3d(4, 2, 1);
+        for (uint n = 0; n < 8; ++n) {
+            assert( graph::degree(graph, n) == 3 );
+        }
+        check_simple(graph, false);
+        graph::destroy(graph);
+
+        graph = generators::lattice_2d(5, 5, false);
+        assert( graph::degree(graph, 0) == 2 && graph::degree(graph, 6) == 4 );
+        check_simple(graph, false);
+        graph::destroy(graph);
+    }
+
+    // Watts–Strogatz: edge count is preserved, and roughly beta of the edges are rewired
+    printf("Checking Watts-Strogatz...\n");
+    for (double beta : { 0., 0.1, 1. }) {
+        uint k = 3;
+        graph::Graph* graph = generators::watts_strogatz(TEST_SIZE, k, beta);
+        assert( graph->edges.size() == 2 * (size_t) TEST_SIZE * k );
+        check_simple(graph, false);
+        uint num_far = 0;
+        for (auto edge : graph->edges) {
+            uint dist = (edge.first > edge.second) ? edge.first - edge.second : edge.second - edge.first;
+            if (std::min(dist, TEST_SIZE - dist) > k) num_far++;
+        }
+        double fraction = (double) num_far / (double) graph->edges.size();
+        printf("\tbeta=%.1f rewired=%.3f\n", beta, fraction);
+        assert( fabs(fraction - beta) < 0.05 );
+        graph::destroy(graph);
+    }
+    // dense lattices run out of far endpoints; the rest of their edges stay on the lattice
+    for (auto nk : { std::make_pair(6u, 2u), std::make_pair(20u, 5u), std::make_pair(21u, 9u) }) {
+        for (double beta : { 0.9, 1. }) {
+            for (int seed = 0; seed < 20; ++seed) {
+                graph::Graph* graph = generators::watts_strogatz(nk.first, nk.second, beta);
+                assert( graph->edges.size() == 2 * (size_t) nk.first * nk.second );
+                check_simple(graph, false);
+                graph::index_edges(graph);
+                assert( graph->edge_index.size() == graph->edges.size() );  // no edge twice
+                graph::destroy(graph);
+            }
+        }
+    }
+
+    // stochastic block model: membership is recorded, and edges concentrate within blocks
+    printf("Checking stochastic block model...\n");
+    {
+        graph::Graph* graph = generators::planted_partition(10, TEST_SIZE / 10, 0.05, 0.001);
+        assert( graph->properties.block.size() == TEST_SIZE );
+        assert( graph->properties.block[0] == 0 && graph->properties.block[TEST_SIZE - 1] == 9 );
+        check_simple(graph, false);
+        size_t within = 0;
+        for (auto edge : graph->edges) {
+            if (graph->properties.block[edge.first] == graph->properties.block[edge.second]) within++;
+        }
+        // expected within: 10 * C(200, 2) * 0.05 ~ 9950, between: 45 * 200^2 * 0.001 = 1800 (each stored twice)
+        printf("\twithin=%zu between=%zu\n", within / 2, (graph->edges.size() - within) / 2);
+        assert( within / 2 > 9000 && within / 2 < 11000 );
+        assert( (graph->edges.size() - within) / 2 > 1400 && (graph->edges.size() - within) / 2 < 2200 );
+        graph::destroy(graph);
+    }
+
+    // force layout: starting from a circle, communities pull together and apart from each other
+    printf("Checking force layout...\n");
+    {
+        const uint blocks = 8, size = 600;
+        graph::Graph* graph = generators::planted_partition(blocks, size, 0.02, 0.0002);
+        generators::layout_circle(graph, 10.f);
+        layout::relax(graph, 150, 1.f, 2);
+        std::vector<double> cx(blocks, 0.), cy(blocks, 0.);
+        for (uint n = 0; n < blocks * size; ++n) {
+            assert( isfinite(graph->properties.x[n]) && isfinite(graph->properties.y[n]) );
+            cx[graph->properties.block[n]] += graph->properties.x[n] / size;
+            cy[graph->properties.block[n]] += graph->properties.y[n] / size;
+        }
+        double spread = 0., separation = 0.;
+        for (uint n = 0; n < blocks * size; ++n) {
+            uint b = graph->properties.block[n];
+            spread += hypot(graph->properties.x[n] - cx[b], graph->properties.y[n] - cy[b]) / (blocks * size);
+        }
+        for (uint a = 0; a < blocks; ++a) {
+            for (uint b = a + 1; b < blocks; ++b) {
+                separation += hypot(cx[a] - cx[b], cy[a] - cy[b]) / (blocks * (blocks - 1) / 2);
+            }
+        }
+        printf("\tspread within blocks=%.2f separation between blocks=%.2f\n", spread, separation);
+        assert( separation > 2. * spread );
+
+        // in the background: positions arrive through sync, and a held node stays put
+        layout::Layout* background = layout::make(graph, 1.f, 2);
+        layout::hold(background, 7, 100.f, -100.f);
+        layout::start(background);
+        while (! layout::sync(background, &graph->properties)) std::this_thread::yield();
+        layout::stop(background);
+        layout::sync(background, &graph->properties);
+        assert( background->iterations > 0 );
+        assert( graph->properties.x[7] == 100.f && graph->properties.y[7] == -100.f );
+        layout::destroy(background);
+        graph::destroy(graph);
+    }
+
+    return 0;
+}
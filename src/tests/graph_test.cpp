@@ -1,9 +1,14 @@
 #include <stdio.h>
 #include <assert.h>
+#include <algorithm>
 
 #include "../types.h"
 #include "../random.h"
 #include "../data_structures/graph.h"
+#include "../data_structures/csr.h"
+#include "../data_structures/builder.h"
+#include "../data_structures/spatial_grid.h"
+#include "../data_structures/sum_tree.h"
 #include "../algorithms/traversal.h"
 
 #define TEST_SIZE (5)
@@ -30,7 +35,7 @@ int main(void) {
     // another empty check
     printf("Empty check degree, foreach match_dest\n");
     for (n = 0; n < TEST_SIZE; ++n) {
-        assert( graph::degree(graph, n) == 0, "degree must be zero" );
+        assert( graph::degree(graph, n) == 0 && "degree must be zero" );
         graph::foreach(graph, n, match_dest, 0);
     }
 
@@ -40,13 +45,13 @@ int main(void) {
     // check spatial coordinates
     printf("Check that all node spatial coordinates are initialized to zero.\n");
     for (n = 0; n < TEST_SIZE; ++n) {
-        assert( graph->nodes[n]->properties->x == 0.f && graph->nodes[n]->properties->y == 0.f );
+        assert( graph->properties.x[n] == 0.f && graph->properties.y[n] == 0.f );
     }
 
     // arrange all nodes in a main diagonal line
     printf("Setting node positions to (n,n), where n is node index.\n");
     for (n = 0; n < TEST_SIZE; ++n) {
-        graph->nodes[n]->properties->x = graph->nodes[n]->properties->y = (float) n;
+        graph->properties.x[n] = graph->properties.y[n] = (float) n;
     }
 
     // add self-edges to all nodes
@@ -105,8 +110,149 @@ int main(void) {
         printf("node: %i\n", n);
     }
 
+    // freeze into CSR form and check that it has the same topology and reaches the same nodes
+    printf("\nFreezing graph\n");
+    graph::CSR* csr = graph::freeze(graph);
+    assert( csr->num_nodes == TEST_SIZE && csr->num_edges == graph->edges.size() );
+    for (n = 0; n < TEST_SIZE; ++n) {
+        assert( graph::degree(csr, n) == graph::degree(graph, n) );
+        for (k = 0; k < TEST_SIZE; ++k) {
+            assert( graph::has_edge(csr, n, k) == graph::has_edge(graph, n, k) );
+        }
+        assert( csr->properties.x[n] == graph->properties.x[n] && csr->properties.y[n] == graph->properties.y[n] );
+    }
+    std::vector<uint> csr_ordering;
+    graph::dfs(csr, 0, graph::accumulate_nodes, (void*) &csr_ordering);
+    std::sort(ordering.begin(), ordering.end());
+    std::sort(csr_ordering.begin(), csr_ordering.end());
+    assert( ordering == csr_ordering );
+    graph::destroy(csr);
+
+    // bulk-build a copy from the edge list (with duplicates) and check that it has the same topology
+    printf("\nBulk building graph\n");
+    std::vector<graph::edge_t> edges(graph->edges.begin(), graph->edges.end());
+    edges.insert(edges.end(), graph->edges.begin(), graph->edges.end());
+    graph::Graph* built = graph::build(TEST_SIZE, edges);
+    assert( built->edges.size() == graph->edges.size() );
+    for (n = 0; n < TEST_SIZE; ++n) {
+        assert( graph::degree(built, n) == graph::degree(graph, n) );
+        for (k = 0; k < TEST_SIZE; ++k) {
+            assert( graph::has_edge(built, n, k) == graph::has_edge(graph, n, k) );
+        }
+    }
+    graph::destroy(built);
+
+    // remove every edge, checking that the edge list index stays consistent with the swap-and-pop
+    printf("\nRemoving all edges\n");
+    while (! graph->edges.empty()) {
+        auto edge = graph->edges[ graph->edges.size() / 2 ];
+        graph::remove_edge(graph, edge.first, edge.second);
+        assert( graph::has_edge(graph, edge.first, edge.second) == 0 );
+        for (uint i = 0; i < graph->edges.size(); ++i) {
+            assert( graph->edge_index[ graph->edges[i] ] == i );
+        }
+    }
+    for (n = 0; n < TEST_SIZE; ++n) {
+        assert( graph::degree(graph, n) == 0 );
+    }
+
     // free the graph
     graph::destroy(graph);
 
+    // arena-allocated graph: grow every adjacency list through several size classes
+    printf("\nChecking arena allocation\n");
+    graph = graph::make(TEST_SIZE, false, graph::ALLOC_ARENA);
+    for (n = 0; n < TEST_SIZE; ++n) {
+        for (k = 0; k < TEST_SIZE; ++k) {
+            graph::add_edge(graph, n, k);
+        }
+    }
+    assert( graph->edges.size() == TEST_SIZE * TEST_SIZE );
+    for (n = 0; n < TEST_SIZE; ++n) {
+        assert( graph::degree(graph, n) == TEST_SIZE );
+        for (k = 0; k < TEST_SIZE; ++k) {
+            assert( graph::has_edge(graph, n, k) == 1 );
+            assert( graph->nodes[n]->adjacent[k] == k );
+        }
+    }
+    graph::destroy(graph);
+
+    // chunks freed by one growing node go back under the class they came from, so a second node growing the same
+    // way is served entirely from the pools
+    graph = graph::make(100, false, graph::ALLOC_ARENA);
+    for (k = 0; k < 100; ++k) graph::add_edge(graph, 0, k);
+    size_t remaining = graph->arena->remaining, num_blocks = graph->arena->blocks.size();
+    for (k = 0; k < 60; ++k) graph::add_edge(graph, 1, k);
+    assert( graph->arena->remaining == remaining && graph->arena->blocks.size() == num_blocks );
+    assert( graph::degree(graph, 0) == 100 && graph::degree(graph, 1) == 60 );
+    graph::destroy(graph);
+
+    printf("\nChecking spatial grid against brute force\n");
+    {
+        const uint num_points = 5000;
+        std::uniform_real_distribution<float> coordinate(-50.f, 50.f);
+        std::vector<float> x(num_points), y(num_points);
+        for (uint i = 0; i < num_points; ++i) {
+            x[i] = coordinate(rng::generator);
+            y[i] = 0.25f * coordinate(rng::generator);
+        }
+        spatial_grid::Grid grid;
+        spatial_grid::build(&grid, x, y, 1.f);
+        assert( grid.nodes.size() == num_points && grid.offsets.back() == num_points );
+        for (int trial = 0; trial < 200; ++trial) {
+            float px = coordinate(rng::generator), py = 0.25f * coordinate(rng::generator);
+            uint best = graph::NIL;
+            float best_d2 = 1.f;
+            uint inside = 0;
+            for (uint i = 0; i < num_points; ++i) {
+                float d2 = (x[i] - px) * (x[i] - px) + (y[i] - py) * (y[i] - py);
+                if (d2 <= best_d2) { best_d2 = d2; best = i; }
+                if (fabsf(x[i] - px) <= 3.f && fabsf(y[i] - py) <= 2.f) inside++;
+            }
+            assert( spatial_grid::nearest(&grid, x, y, px, py, 1.f) == best );
+            uint found = 0;
+            spatial_grid::query(&grid, px - 3.f, py - 2.f, px + 3.f, py + 2.f, [&](uint i) {
+                if (fabsf(x[i] - px) <= 3.f && fabsf(y[i] - py) <= 2.f) found++;
+            });
+            assert( found == inside );
+        }
+        // points on a line still get a usable grid
+        std::vector<float> zeros(num_points, 0.f);
+        spatial_grid::build(&grid, x, zeros, 0.f);
+        assert( grid.ny == 1 && grid.nx > 1 );
+        assert( spatial_grid::nearest(&grid, x, zeros, x[17], 0.f, 0.5f) == 17 );
+    }
+
+    // sum tree: totals follow updates, and leaves are sampled in proportion to their weights
+    printf("Checking sum tree...\n");
+    {
+        const size_t num_leaves = 13;  // not a power of two
+        std::vector<double> weights(num_leaves);
+        for (size_t i = 0; i < num_leaves; ++i) weights[i] = (double) (i % 4);  // some zero weights
+        sum_tree::SumTree tree;
+        sum_tree::assign(&tree, weights);
+        weights[5] = 7.;
+        sum_tree::set(&tree, 5, 7.);
+        double total = 0.;
+        for (double w : weights) total += w;
+        assert( fabs(sum_tree::total(&tree) - total) < 1e-9 );
+        assert( sum_tree::get(&tree, 5) == 7. );
+
+        const uint draws = 200000;
+        std::vector<uint> counts(num_leaves, 0);
+        std::uniform_real_distribution<double> uniform(0., 1.);
+        for (uint d = 0; d < draws; ++d) {
+            counts[sum_tree::sample(&tree, uniform(rng::generator) * sum_tree::total(&tree))]++;
+        }
+        for (size_t i = 0; i < num_leaves; ++i) {
+            double expected = draws * weights[i] / total;
+            if (weights[i] == 0.) assert( counts[i] == 0 );
+            else assert( fabs(counts[i] - expected) < 5. * sqrt(expected) );
+        }
+        // the very ends of the range land on leaves with weight
+        assert( sum_tree::get(&tree, sum_tree::sample(&tree, 0.)) > 0. );
+        assert( sum_tree::get(&tree, sum_tree::sample(&tree, sum_tree::total(&tree))) > 0. );
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../types.h"
+#include "../random.h"
+#include "../data_structures/graph.h"
+#include "../data_structures/csr.h"
+#include "../generators/stochastic_block_model.h"
+#include "../generators/layout.h"
+#include "../dynamics/utils.h"
+#include "../io/binary.h"
+#include "../io/edge_list.h"
+#include "../io/snapshot.h"
+#include "../io/scenario.h"
+
+#define TEST_SIZE (1000)
+#define TEST_PATH "io_test.graph"
+
+// Two frozen graphs must have identical topology and properties.
+static void check_same(const graph::CSR* a, const graph::CSR* b) {
+    assert( a->num_nodes == b->num_nodes && a->num_edges == b->num_edges );
+    assert( a->is_undirected == b->is_undirected );
+    for (uint n = 0; n <= a->num_nodes; ++n) {
+        assert( a->offsets[n] == b->offsets[n] );
+    }
+    for (uint i = 0; i < a->num_edges; ++i) {
+        assert( a->neighbors[i] == b->neighbors[i] );
+    }
+    assert( a->properties.x == b->properties.x && a->properties.y == b->properties.y );
+    assert( a->properties.opinion.words == b->properties.opinion.words );
+    assert( a->properties.block == b->properties.block );
+}
+
+int main(void) {
+    graph::Graph* graph = generators::planted_partition(4, TEST_SIZE / 4, 0.02, 0.002);
+    generators::layout_circle(graph, 10.f);
+    init_graph_opinions(graph);
+    graph::CSR* frozen = graph::freeze(graph);
+
+    // round trip through a file mapping
+    printf("Saving and mapping graph\n");
+    bool saved = io::save(graph, TEST_PATH);
+    assert( saved );
+    graph::CSR* mapped = io::load_csr(TEST_PATH);
+    assert( mapped != nullptr && mapped->backing != nullptr );
+    check_same(frozen, mapped);
+
+    // the mapped graph is usable as-is, and its opinions are a private copy
+    for (uint n = 0; n < mapped->num_nodes; ++n) {
+        graph::set_opinion(mapped, n, true);
+    }
+    assert( is_consensus_reached(mapped) );
+    graph::destroy(mapped);
+    mapped = io::load_csr(TEST_PATH);
+    check_same(frozen, mapped);
+    graph::destroy(mapped);
+
+    // loading as a mutable graph gives back the same graph
+    printf("Loading graph\n");
+    graph::Graph* loaded = io::load(TEST_PATH);
+    assert( loaded != nullptr && loaded->is_undirected );
+    assert( loaded->edges.size() == graph->edges.size() );
+    for (auto edge : graph->edges) {
+        assert( graph::has_edge(loaded, edge.first, edge.second) );
+    }
+    graph::add_edge(loaded, 0, 0);
+    graph::CSR* refrozen = graph::freeze(loaded);
+    assert( graph::has_edge(refrozen, 0, 0) );
+    graph::destroy(refrozen);
+    graph::destroy(loaded);
+
+    // empty graphs and graphs without blocks round trip too
+    printf("Saving empty graph\n");
+    graph::Graph* empty = graph::make(0);
+    saved = io::save(empty, TEST_PATH);
+    assert( saved );
+    mapped = io::load_csr(TEST_PATH);
+    assert( mapped != nullptr && mapped->num_nodes == 0 && mapped->num_edges == 0 );
+    graph::destroy(mapped);
+    graph::destroy(empty);
+
+    // corrupt and missing files are rejected
+    printf("Rejecting bad files\n");
+    FILE* fp = fopen(TEST_PATH, "wb");
+    fprintf(fp, "not a graph");
+    fclose(fp);
+    assert( io::load_csr(TEST_PATH) == nullptr );
+    remove(TEST_PATH);
+    assert( io::load_csr(TEST_PATH) == nullptr );
+
+    // edge list: comments, sparse ids, mixed separators, CRLF, trailing fields and a missing final newline
+    printf("Reading edge list\n");
+    fp = fopen(TEST_PATH, "wb");
+    fprintf(fp, "# Directed graph\n%% another comment\n10\t20\r\n20 30 0.5\n\n30,10\nbad line\n10\t20\n"
+        "18446744073709551615 20\n5000000000 10");
+    fclose(fp);
+    std::vector<uint64_t> ids;
+    graph::Graph* imported = io::read_edge_list(TEST_PATH, false, graph::ALLOC_MALLOC, &ids);
+    assert( imported != nullptr && imported->nodes.size() == 5 && imported->edges.size() == 5 );
+    assert( ids.size() == 5 && ids[0] == 10 && ids[1] == 20 && ids[2] == 30 && ids[3] == 5000000000ull );
+    assert( ids[4] == UINT64_MAX && graph::has_edge(imported, 4, 1) );
+    assert( graph::has_edge(imported, 0, 1) && graph::has_edge(imported, 1, 2) && graph::has_edge(imported, 2, 0) );
+    assert( graph::has_edge(imported, 3, 0) && ! graph::has_edge(imported, 1, 0) );
+    graph::destroy(imported);
+
+    // the result must not depend on how the file is split between threads, with dense ids (remapped through the
+    // bitmap) or sparse ones (through the table of distinct ids)
+    printf("Reading edge list on several threads\n");
+    for (uint64_t stride : { 3ull, 1000003ull }) {
+        fp = fopen(TEST_PATH, "wb");
+        for (auto edge : graph->edges) {
+            fprintf(fp, "%llu\t%llu\n", (unsigned long long) (stride * edge.first + 7),
+                (unsigned long long) (stride * edge.second + 7));
+        }
+        fclose(fp);
+        for (uint num_threads = 1; num_threads <= 8; num_threads *= 2) {
+            imported = io::read_edge_list(TEST_PATH, true, graph::ALLOC_MALLOC, &ids, num_threads);
+            assert( imported != nullptr && imported->edges.size() == graph->edges.size() );
+            for (auto edge : imported->edges) {
+                uint u = (uint) ((ids[edge.first] - 7) / stride), v = (uint) ((ids[edge.second] - 7) / stride);
+                assert( graph::has_edge(graph, u, v) );
+            }
+            graph::destroy(imported);
+        }
+    }
+    remove(TEST_PATH);
+
+    // JSON snapshot round trip
+    printf("Saving and loading snapshot\n");
+    saved = io::save_snapshot(graph, TEST_PATH);
+    assert( saved );
+    loaded = io::load_snapshot(TEST_PATH);
+    assert( loaded != nullptr );
+    refrozen = graph::freeze(loaded);
+    check_same(frozen, refrozen);
+    graph::destroy(refrozen);
+    graph::destroy(loaded);
+    fp = fopen(TEST_PATH, "wb");
+    fprintf(fp, "{\"format\":\"something else\",\"num_nodes\":0}");
+    fclose(fp);
+    assert( io::load_snapshot(TEST_PATH) == nullptr );
+
+    // scenarios: the same seed gives the same graph, and outputs are written
+    printf("Running scenario\n");
+    fp = fopen(TEST_PATH, "wb");
+    fprintf(fp, "{\"seed\": 7, \"graph\": {\"generator\": \"barabasi_albert\", \"n\": 100, \"m\": 2},"
+        " \"model\": \"voter\", \"steps\": 50, \"outputs\": [{\"type\": \"binary\", \"path\": \"%s\"}]}",
+        TEST_PATH ".{step}");
+    fclose(fp);
+    io::Scenario scenario;
+    bool loaded_scenario = io::load_scenario(TEST_PATH, &scenario);
+    assert( loaded_scenario );
+    assert( scenario.model == io::MODEL_VOTER && scenario.steps == 50 && scenario.outputs.size() == 1 );
+    graph::Graph* first = io::make_graph(&scenario);
+    graph::Graph* second = io::make_graph(&scenario);
+    assert( first != nullptr && second != nullptr && first->edges == second->edges );
+    assert( first->properties.opinion.words == second->properties.opinion.words );
+    uint64_t steps = 0;
+    while (! io::is_finished(&scenario, first, steps)) {
+        io::step(&scenario, first);
+        io::write_outputs(&scenario, first, ++steps, false);
+    }
+    io::write_outputs(&scenario, first, steps, true);
+    io::close_outputs(&scenario);
+    mapped = io::load_csr(TEST_PATH ".50");
+    assert( mapped != nullptr && mapped->num_edges == first->edges.size() );
+    graph::destroy(mapped);
+    graph::destroy(second);
+    graph::destroy(first);
+    remove(TEST_PATH ".50");
+
+    // parameters the generators would reject are reported instead
+    for (const char* description : {
+            "{\"generator\": \"barabasi_albert\", \"n\": 3, \"m\": 5}",
+            "{\"generator\": \"erdos_renyi\", \"n\": 10, \"p\": 1.5}",
+            "{\"generator\": \"erdos_renyi_m\", \"n\": 4, \"m\": 7, \"directed\": false}",
+            "{\"generator\": \"watts_strogatz\", \"n\": 5, \"k\": 2, \"beta\": 0.5}",
+            "{\"generator\": \"ring_lattice\", \"n\": 4, \"k\": 2}",
+            "{\"generator\": \"lattice\", \"dims\": [4, 0]}",
+            "{\"generator\": \"planted_partition\", \"blocks\": 2, \"block_size\": 5, \"p_in\": -1, \"p_out\": 0}",
+            "{\"generator\": \"stochastic_block_model\", \"sizes\": [3, 3], \"probs\": [[0.5, 0.1]]}" }) {
+        scenario.graph = nlohmann::json::parse(description);
+        assert( io::make_graph(&scenario) == nullptr );
+    }
+    // and so is a grid layout with more cells than the graph has nodes
+    scenario.graph = { {"generator", "ring_lattice"}, {"n", 12}, {"k", 1} };
+    scenario.layout = { {"type", "grid"}, {"dims", {4, 3}} };
+    graph::Graph* grid = io::make_graph(&scenario);
+    assert( grid != nullptr && grid->properties.x[11] == 1.5f && grid->properties.y[11] == 1.f );
+    graph::destroy(grid);
+    scenario.layout["dims"] = {4, 4};
+    assert( io::make_graph(&scenario) == nullptr );
+    // without a layout type, a lattice keeps its own grid
+    scenario.graph = { {"generator", "lattice"}, {"dims", {3, 2}} };
+    scenario.layout = io::default_scenario().layout;
+    grid = io::make_graph(&scenario);
+    assert( grid != nullptr && grid->properties.x[5] == 1.f && grid->properties.y[5] == 0.5f );
+    graph::destroy(grid);
+    fp = fopen(TEST_PATH, "wb");
+    fprintf(fp, "{\"model\": \"unknown\"}");
+    fclose(fp);
+    loaded_scenario = io::load_scenario(TEST_PATH, &scenario);
+    assert( ! loaded_scenario );
+    remove(TEST_PATH);
+
+    graph::destroy(frozen);
+    graph::destroy(graph);
+    return 0;
+}
@@ -1,10 +1,16 @@
 #include <stdio.h>
+#include <math.h>
 #include <assert.h>
 
 #include "../types.h"
 #include "../data_structures/graph.h"
 #include "../dynamics/models/voter_model.h"
+#include "../dynamics/models/sznajd.h"
+#include "../dynamics/diff.h"
 #include "../dynamics/utils.h"
+#include "../dynamics/active_links.h"
+#include "../dynamics/gillespie.h"
+#include "../dynamics/replicas.h"
 
 #define TEST_SIZE (64)
 #define TEST_SIMULATION_STEPS (100)
@@ -12,7 +18,7 @@
 void print_network(const graph::Graph* graph) {
     printf("Opinions:\n");
     for (uint i = 0; i < graph->nodes.size(); ++i) {
-        printf("\tNode %i, opinion %i\n", i, graph->nodes[i]->properties->opinion);
+        printf("\tNode %i, opinion %i\n", i, graph::opinion(graph, i));
     }
 }
 
@@ -32,13 +38,13 @@ int main(void) {
     printf("\nChecking single step of voter model...\n");
     auto pair = sample_edge(graph);
     printf("\tOpinion target: %i | Opinion neighbor: %i\n", 
-        pair.first->properties->opinion,
-        pair.second->properties->opinion);
+        graph::opinion(graph, pair.first),
+        graph::opinion(graph, pair.second));
     step_voter_dynamics(graph, pair);
     printf("\tOpinion target: %i | Opinion neighbor: %i\n\n", 
-        pair.first->properties->opinion,
-        pair.second->properties->opinion);
-    assert( pair.first->properties->opinion == pair.second->properties->opinion );
+        graph::opinion(graph, pair.first),
+        graph::opinion(graph, pair.second));
+    assert( graph::opinion(graph, pair.first) == graph::opinion(graph, pair.second) );
 
     // run simulation to consensus
     printf("Running simulation for %i steps...\n", TEST_SIMULATION_STEPS);
@@ -55,5 +61,182 @@ int main(void) {
     }
     print_network(graph);
 
+    // opinion counts must cover every node
+    auto histogram = opinion_histogram(graph);
+    assert( histogram.first + histogram.second == TEST_SIZE );
+    assert( is_consensus_reached(graph) == (histogram.first == 0 || histogram.second == 0) );
+
+    // replaying the recorded changes onto the starting opinions must give the final opinions
+    printf("Checking recorded diffs...\n");
+    Diff diff;
+    ring_buffer::init(&diff, 1 << 16);
+    for (int model = 0; model < 2; ++model) {
+        init_graph_opinions(graph);
+        bitset::Bitset replayed = graph->properties.opinion;
+        size_t num_changes = 0;
+        for (uint step = 0; step < TEST_SIMULATION_STEPS; ++step) {
+            if (model == 0) step_voter_dynamics(graph, sample_edge(graph), &diff);
+            else step_sznajd_dynamics(graph, sample_edge(graph), &diff);
+            num_changes += ring_buffer::drain(&diff, [&](const OpinionChange& change) {
+                assert( change.before != change.after );
+                assert( bitset::get(&replayed, change.node) == change.before );
+                apply_change(&replayed, change);
+            });
+        }
+        printf("\t%s: %zu changes\n", model == 0 ? "voter" : "sznajd", num_changes);
+        assert( replayed.words == graph->properties.opinion.words );
+    }
+    assert( ! ring_buffer::overflowed(&diff) );
+
+    // a full ring drops changes and says so
+    Diff small;
+    ring_buffer::init(&small, 4);
+    for (uint n = 0; n < TEST_SIZE; ++n) {
+        set_opinion_recorded(graph, n, ! graph::opinion(graph, n), &small);
+    }
+    assert( ring_buffer::size(&small) == 4 && ring_buffer::overflowed(&small) );
+    uint64_t epoch = ring_buffer::reset(&small);
+    assert( epoch == 1 );
+    assert( ring_buffer::size(&small) == 0 && ! ring_buffer::overflowed(&small) );
+
+    // the active-link engine's active set must hold every edge a plain step would change something with; for the
+    // voter model exactly those, for the Sznajd model also edges whose step changes a node and then changes it back
+    printf("Checking active-link sampler...\n");
+    for (int model = 0; model < 2; ++model) {
+        for (int undirected = 0; undirected < 2; ++undirected) {
+            auto sparse = graph::make(TEST_SIZE, undirected);
+            init_graph_opinions(sparse);
+            std::uniform_int_distribution<uint> pick_node(0, TEST_SIZE - 1);
+            for (uint e = 0; e < 3 * TEST_SIZE; ++e) {
+                uint u = pick_node(rng::generator), v = pick_node(rng::generator);
+                if (u == v || graph::has_edge(sparse, u, v)) continue;
+                graph::add_edge(sparse, u, v);
+                if (undirected) graph::add_edge(sparse, v, u);
+            }
+            auto rule = (model == 0) ? active_links::RULE_VOTER : active_links::RULE_SZNAJD;
+            auto engine = active_links::make(sparse, rule);
+            uint64_t last_steps = 0;
+            for (int round = 0; round < 20; ++round) {
+                active_links::advance(engine, UINT64_MAX, 3);
+                assert( engine->steps >= last_steps );
+                last_steps = engine->steps;
+
+                size_t expected = 0;
+                bitset::Bitset saved = sparse->properties.opinion;
+                for (uint id = 0; id < engine->edges.size(); ++id) {
+                    // try the edge, then put every opinion back (a Sznajd step can change a node twice)
+                    if (model == 0) step_voter_dynamics(sparse, engine->edges[id]);
+                    else step_sznajd_dynamics(sparse, engine->edges[id]);
+                    bool changes = (sparse->properties.opinion.words != saved.words);
+                    sparse->properties.opinion = saved;
+                    bool active = (engine->position[id] != graph::NIL);
+                    if (changes) assert( active );
+                    if (model == 0) assert( changes == active );
+                    expected += active;
+                }
+                assert( expected == active_links::num_active(engine) );
+                if (expected == 0) break;
+            }
+            printf("\t%s, %s: %zu active edges after %llu steps\n", model == 0 ? "voter" : "sznajd",
+                undirected ? "undirected" : "directed", active_links::num_active(engine),
+                (unsigned long long) engine->steps);
+            active_links::destroy(engine);
+            graph::destroy(sparse);
+        }
+    }
+
+    // on the complete graph the voter model reaches consensus after ~N^2 steps with either sampler
+    double plain_mean = 0., skipping_mean = 0.;
+    const int runs = 50;
+    for (int run = 0; run < runs; ++run) {
+        init_graph_opinions(graph);
+        uint64_t steps = 0;
+        while (! is_consensus_reached(graph)) {
+            step_voter_dynamics(graph, sample_edge(graph));
+            steps++;
+        }
+        plain_mean += (double) steps / runs;
+
+        init_graph_opinions(graph);
+        auto engine = active_links::make(graph, active_links::RULE_VOTER);
+        while (active_links::num_active(engine) > 0) active_links::advance(engine, UINT64_MAX);
+        assert( is_consensus_reached(graph) );
+        skipping_mean += (double) engine->steps / runs;
+        active_links::destroy(engine);
+    }
+    printf("\tmean steps to consensus: %.0f plain, %.0f skipping\n", plain_mean, skipping_mean);
+    assert( skipping_mean > 0.5 * plain_mean && skipping_mean < 2. * plain_mean );
+
+    // continuous time: events come at the total rate, and a node with rate 0 never acts, so under the voter model it
+    // keeps its opinion and the others come round to it
+    printf("Checking continuous-time engine...\n");
+    {
+        init_graph_opinions(graph);
+        std::vector<double> rates = gillespie::degree_rates(graph);
+        rates[0] = 0.;
+        auto clock = gillespie::make(graph, step_voter_dynamics, rates);
+        bool stubborn = graph::opinion(graph, 0);
+        double total = gillespie::total_rate(clock);
+        uint64_t run = gillespie::advance(clock, 10000);
+        assert( run == 10000 && clock->events == 10000 );
+        double mean_wait = clock->time / (double) clock->events;
+        printf("\tmean wait %.3g, expected %.3g\n", mean_wait, 1. / total);
+        assert( fabs(mean_wait * total - 1.) < 0.05 );
+        while (! is_consensus_reached(graph)) gillespie::advance(clock, clock->events + TEST_SIZE);
+        assert( graph::opinion(graph, 0) == stubborn );
+
+        // stopping at a time limit
+        double until = clock->time + 1.;
+        gillespie::advance(clock, UINT64_MAX, until);
+        assert( clock->time == until );
+        // with every rate 0 nothing happens
+        for (uint n = 0; n < TEST_SIZE; ++n) gillespie::set_rate(clock, n, 0.);
+        assert( gillespie::advance(clock, UINT64_MAX) == 0 );
+        gillespie::destroy(clock);
+    }
+
+    // replica-packed engine: each lane picks its own neighbor uniformly, whatever the degree
+    printf("Checking %d packed replicas...\n", REPLICA_LANES);
+    for (uint degree : { 1u, 4u, 5u, 300u }) {
+        auto star = graph::make(degree + 1);
+        for (uint n = 1; n <= degree; ++n) graph::add_edge(star, 0, n);
+        auto frozen = graph::freeze(star);
+        auto engine = replicas::make(frozen);
+        for (uint n = 1; n <= degree; ++n) {
+            for (auto& word : engine->opinions[n].words) word = (n == 1) ? ~(uint64_t) 0 : 0;
+        }
+        const uint trials = 400;
+        uint64_t num_true = 0;
+        for (uint t = 0; t < trials; ++t) {
+            replicas::update(engine, 0);
+            for (uint lane = 0; lane < REPLICA_LANES; ++lane) num_true += replicas::opinion(engine, 0, lane);
+        }
+        double draws = (double) trials * REPLICA_LANES;
+        double expected = draws / degree;
+        printf("\tdegree %u: %llu of %.0f lanes copied neighbor 1, expected %.0f\n", degree,
+            (unsigned long long) num_true, draws, expected);
+        assert( fabs((double) num_true - expected) < 5. * sqrt(expected) + 1. );
+        replicas::destroy(engine);
+        graph::destroy(frozen);
+        graph::destroy(star);
+    }
+    {
+        auto frozen = graph::freeze(graph);
+        auto engine = replicas::make(frozen);
+        while (replicas::num_consensus(engine) < REPLICA_LANES) replicas::advance(engine, TEST_SIZE);
+        double mean = 0.;
+        for (uint lane = 0; lane < REPLICA_LANES; ++lane) {
+            // the running counts agree with the bits, and every lane has settled on one opinion
+            uint num_true = 0;
+            for (uint n = 0; n < TEST_SIZE; ++n) num_true += replicas::opinion(engine, n, lane);
+            assert( num_true == engine->num_true[lane] && (num_true == 0 || num_true == TEST_SIZE) );
+            mean += (double) engine->consensus[lane] / REPLICA_LANES;
+        }
+        printf("\tmean steps to consensus: %.0f packed, %.0f plain\n", mean, plain_mean);
+        assert( mean > 0.5 * plain_mean && mean < 2. * plain_mean );
+        replicas::destroy(engine);
+        graph::destroy(frozen);
+    }
+
     return 0;
 }
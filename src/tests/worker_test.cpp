@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../types.h"
+#include "../random.h"
+#include "../thread_pool.h"
+#include "../data_structures/graph.h"
+#include "../data_structures/triple_buffer.h"
+#include "../dynamics/utils.h"
+#include "../dynamics/worker.h"
+#include "../dynamics/diff.h"
+#include "../dynamics/ensemble.h"
+#include "../dynamics/models/voter_model.h"
+#include "../dynamics/models/sznajd.h"
+#include "../io/scenario.h"
+
+#define TEST_SIZE (1000)
+#define TEST_VALUES (200000)
+
+int main(void) {
+    // triple buffer: the consumer only ever sees whole values, in increasing order
+    printf("Checking triple buffer\n");
+    {
+        triple_buffer::TripleBuffer<std::vector<uint64_t>> buffer;
+        for (auto& slot : buffer.slots) slot.assign(16, 0);
+        triple_buffer::init(&buffer);
+
+        std::thread producer([&]() {
+            for (uint64_t v = 1; v <= TEST_VALUES; ++v) {
+                auto* slot = triple_buffer::writable(&buffer);
+                for (auto& word : *slot) word = v;
+                triple_buffer::publish(&buffer);
+            }
+        });
+        uint64_t last = 0, num_seen = 0;
+        while (last < TEST_VALUES) {
+            if (! triple_buffer::acquire(&buffer)) continue;
+            const auto* slot = triple_buffer::readable(&buffer);
+            uint64_t v = (*slot)[0];
+            for (auto word : *slot) assert( word == v );
+            assert( v > last );
+            last = v;
+            num_seen++;
+        }
+        producer.join();
+        printf("\tsaw %llu of %d values\n", (unsigned long long) num_seen, TEST_VALUES);
+    }
+
+    // unthrottled worker runs to consensus, and its last snapshot agrees with the graph
+    printf("Running worker to consensus\n");
+    io::Scenario scenario = io::default_scenario();
+    scenario.graph = { {"generator", "watts_strogatz"}, {"n", TEST_SIZE}, {"k", 3}, {"beta", 0.2} };
+    scenario.model = io::MODEL_VOTER;
+    graph::Graph* graph = io::make_graph(&scenario);
+    worker::Worker* sim = worker::start(graph, &scenario);
+    const worker::Snapshot* snapshot = worker::latest(sim);
+    assert( snapshot->step == 0 && snapshot->opinion.size == TEST_SIZE );
+    while (! worker::latest(sim)->finished) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    snapshot = worker::latest(sim);
+    assert( snapshot->step > 0 && is_consensus_reached(graph) );
+    assert( snapshot->opinion.words == graph->properties.opinion.words );
+    assert( snapshot->histogram == opinion_histogram(graph) );
+    printf("\tconsensus after %llu steps\n", (unsigned long long) snapshot->step);
+    worker::stop(sim);
+    graph::destroy(graph);
+
+    // the scenario's sampler is used: the engines reach consensus too, and changes they make reach a follower
+    for (io::sampler_type sampler : { io::SAMPLER_ACTIVE_LINKS, io::SAMPLER_GILLESPIE }) {
+        scenario.sampler = sampler;
+        graph = io::make_graph(&scenario);
+        Diff diff;
+        ring_buffer::init(&diff, 1 << 20);
+        sim = worker::start(graph, &scenario, 0., false, &diff);
+        assert( (sim->engine != nullptr) == (sampler == io::SAMPLER_ACTIVE_LINKS) );
+        assert( (sim->clock != nullptr) == (sampler == io::SAMPLER_GILLESPIE) );
+        worker::Follower follower;
+        worker::init_follower(sim, &follower);
+        auto ignore = [](const OpinionChange&) {};
+        while (! worker::latest(sim)->finished) worker::follow(sim, &follower, ignore);
+        while (worker::follow(sim, &follower, ignore) || follower.resyncing) {}
+        snapshot = worker::latest(sim);
+        assert( is_consensus_reached(graph) && follower.opinion.words == graph->properties.opinion.words );
+        printf("\t%s: consensus after %llu steps\n", sampler == io::SAMPLER_ACTIVE_LINKS ? "active links" : "gillespie",
+            (unsigned long long) snapshot->step);
+        worker::stop(sim);
+        graph::destroy(graph);
+    }
+    scenario.sampler = io::SAMPLER_EDGE;
+
+    // rate-limited and paused workers hold back. Only orderings are checked, never how much got done in a given
+    // time, with a generous deadline for anything that has to happen; a loaded machine can starve the worker.
+    printf("Checking rate limit and pause\n");
+    auto poll = [](auto condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (! condition()) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    };
+    scenario.steps = 1000000000;
+    graph = io::make_graph(&scenario);
+    auto started = std::chrono::steady_clock::now();
+    sim = worker::start(graph, &scenario, 1000.);
+    bool reached = poll([&] { return sim->steps.load() >= 20; });
+    assert( reached );
+    uint64_t steps = sim->steps.load();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    printf("\t%llu steps in %.3f s at 1000 steps/sec\n", (unsigned long long) steps, elapsed);
+    assert( steps <= 1000. * elapsed + 1. );
+    // paused: once the count holds still for a while it never moves again, and the last snapshot has caught up
+    worker::set_paused(sim, true);
+    reached = poll([&] {
+        uint64_t before = sim->steps.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return sim->steps.load() == before;
+    });
+    assert( reached );
+    steps = sim->steps.load();
+    reached = poll([&] { return worker::latest(sim)->step == steps; });
+    assert( reached );
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert( sim->steps.load() == steps );
+    // resumed without a rate limit: stepping picks up again, past what the old rate allowed
+    worker::set_rate(sim, 0.);
+    worker::set_paused(sim, false);
+    reached = poll([&] { return sim->steps.load() > steps + 1000; });
+    assert( reached );
+    worker::stop(sim);
+    graph::destroy(graph);
+
+    // a follower that applies the worker's changes (resyncing on overflow) ends up with the worker's opinions. The
+    // worker first runs unfollowed for longer than the small ring lasts, then slowly enough for the follower to keep
+    // up, so that ring overflows, resyncs and carries changes one by one afterwards
+    printf("Following worker through diffs\n");
+    for (uint capacity = 1 << 16; capacity >= 16; capacity >>= 12) {
+        scenario.steps = 200000;
+        graph = io::make_graph(&scenario);
+        Diff diff;
+        ring_buffer::init(&diff, capacity);
+        sim = worker::start(graph, &scenario, 0., false, &diff);
+        worker::Follower follower;
+        worker::init_follower(sim, &follower);
+        size_t num_applied = 0, num_resyncs = 0;
+        auto count = [&](const OpinionChange&) { num_applied++; };
+        reached = poll([&] { return sim->steps.load() >= 5000; });
+        assert( reached );
+        worker::set_rate(sim, 200.);
+        reached = poll([&] {
+            if (worker::follow(sim, &follower, count)) num_resyncs++;
+            return ! follower.resyncing && num_applied > 0;
+        });
+        assert( reached );
+        // by now the small ring has overflowed (starting a new epoch) and been resynced past
+        assert( capacity > 5000 || follower.epoch > 0 );
+        worker::set_rate(sim, 0.);
+        while (! worker::latest(sim)->finished) {
+            if (worker::follow(sim, &follower, count)) num_resyncs++;
+        }
+        // the final snapshot is published after the last change, so one or two more calls catch up
+        while (worker::follow(sim, &follower, count) || follower.resyncing) {}
+        printf("\tcapacity %u: applied %zu changes, %zu resyncs\n", capacity, num_applied, num_resyncs);
+        assert( num_applied > 0 && num_resyncs > 0 );
+        assert( follower.opinion.words == graph->properties.opinion.words );
+        worker::stop(sim);
+        graph::destroy(graph);
+    }
+
+    // random streams: Philox4x32-10 known answers (Random123), O(1) skipping, and streams that depend only on
+    // (master, id)
+    printf("Checking random streams\n");
+    {
+        rng::Philox gen = rng::stream(0, 0);
+        assert( gen() == 0xe169c58d6627e8d5ull && gen() == 0x9b00dbd8bc57ac4cull );
+        gen = rng::stream(0x299f31d0a4093822ull, 0x0370734413198a2eull);
+        gen.position = 0x85a308d3243f6a88ull;
+        assert( gen() == 0x94fdccebd16cfe09ull && gen() == 0x24126ea15001e420ull );
+
+        rng::Philox a = rng::stream(42, 3), b = rng::stream(42, 3);
+        std::vector<uint64_t> values(102);
+        for (auto& v : values) v = a();
+        for (uint64_t count : { 0u, 1u, 2u, 37u, 100u }) {
+            b = rng::stream(42, 3);
+            b();  // start mid-block
+            rng::skip(&b, count);
+            assert( b() == values[1 + count] );
+        }
+        assert( rng::stream(42, 4)() != values[0] && rng::stream(43, 3)() != values[0] );
+
+        rng::seed(5);
+        uint64_t first = rng::generator();
+        rng::seed(5);
+        assert( rng::master_seed() == 5 && rng::generator() == first );
+
+        // replica streams never coincide with a named stream, the main one included
+        for (uint64_t id : { ensemble::stream_id(0, 0), ensemble::stream_id(0, UINT32_MAX),
+                             ensemble::stream_id((1u << 31) - 1, UINT32_MAX) }) {
+            assert( id < RNG_STREAM_NAMED );
+            assert( id != RNG_STREAM_MAIN && id != RNG_STREAM_WORKER );
+        }
+        rng::seed(5);
+        assert( rng::stream(rng::master_seed(), ensemble::stream_id(0, 0))() != first );
+    }
+
+    // thread pool: every task runs exactly once, including tasks submitted by tasks
+    printf("Checking thread pool\n");
+    {
+        auto pool = thread_pool::make(4);
+        const uint num_tasks = 1000;
+        std::vector<std::atomic<uint>> runs(2 * num_tasks);
+        for (auto& r : runs) r = 0;
+        for (uint t = 0; t < num_tasks; ++t) {
+            thread_pool::submit(pool, [pool, t, num_tasks, &runs] {
+                runs[t]++;
+                thread_pool::submit(pool, [t, num_tasks, &runs] { runs[num_tasks + t]++; });
+            });
+        }
+        thread_pool::wait(pool);
+        for (auto& r : runs) assert( r == 1 );
+        // the pool is reusable after a wait
+        std::atomic<uint> more{ 0 };
+        for (uint t = 0; t < 100; ++t) thread_pool::submit(pool, [&more] { more++; });
+        thread_pool::wait(pool);
+        assert( more == 100 );
+        thread_pool::destroy(pool);
+    }
+
+    // ensemble: results cover every replica once and do not depend on the number of threads
+    printf("Checking ensemble\n");
+    {
+        auto graph = graph::make(64);
+        for (uint n = 0; n < 64; ++n) {
+            graph::add_edge(graph, n, (n + 1) % 64);
+            graph::add_edge(graph, (n + 1) % 64, n);
+            graph::add_edge(graph, n, (n + 7) % 64);
+        }
+        auto topology = graph::freeze(graph);
+        std::vector<ensemble::Point> points(2);
+        points[0] = { topology, step_voter_dynamics, 0, 50 };
+        points[1] = { topology, step_sznajd_dynamics, 2000, 50 };
+
+        std::vector<std::vector<ensemble::Result>> runs;
+        for (uint threads : { 1u, 3u }) {
+            auto pool = thread_pool::make(threads);
+            std::vector<ensemble::Result> results(100);
+            std::vector<uint> seen(100, 0);
+            ensemble::run(pool, points, 7, [&](const ensemble::Result& result) {
+                uint at = result.point * 50 + result.replica;
+                seen[at]++;
+                results[at] = result;
+            });
+            thread_pool::destroy(pool);
+            for (uint v : seen) assert( v == 1 );
+            runs.push_back(results);
+        }
+        ensemble::Summary voter;
+        for (uint i = 0; i < 100; ++i) {
+            const ensemble::Result& a = runs[0][i];
+            const ensemble::Result& b = runs[1][i];
+            assert( a.steps == b.steps && a.consensus == b.consensus && a.magnetization == b.magnetization );
+            if (a.point == 0) {
+                // voter runs go to consensus, which is where they stop
+                assert( a.consensus && fabs(a.magnetization) == 1. );
+                ensemble::add(&voter, a);
+            } else {
+                assert( a.consensus || a.steps == 2000 );
+            }
+        }
+        // any replica can be replayed on its own
+        ensemble::Result replayed = ensemble::run_replica(&points[1], 1, 17, 7);
+        assert( replayed.steps == runs[0][67].steps && replayed.magnetization == runs[0][67].magnetization );
+        printf("\tvoter: %llu runs, steps %.0f +- %.0f\n", (unsigned long long) voter.count, voter.mean_steps,
+            ensemble::stddev_steps(&voter));
+        assert( voter.count == 50 && voter.consensus == 50 && voter.mean_abs_magnetization == 1. );
+        graph::destroy(topology);
+        graph::destroy(graph);
+    }
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+A fixed set of worker threads running submitted tasks, with work stealing.
+
+Each worker owns a deque of tasks. A worker takes tasks from the back of its own deque (newest first, so tasks that
+submit more tasks keep their data warm) and, when that is empty, steals from the front of the others' (oldest first,
+so thieves take the larger, older pieces of work). Tasks submitted from outside the pool are dealt round-robin over
+the deques; tasks submitted from inside a task go to that worker's own deque. Idle workers sleep until there is work.
+
+Each deque has its own lock, which is only contended when a thief and the owner meet on the same deque. That suits
+tasks that run for a while (whole simulation runs, not single steps).
+*/
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+
+#include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace thread_pool {
+    //// Types
+    typedef struct pool Pool;
+    typedef std::function<void()> Task;
+
+    //// forward declarations
+    // structs
+    struct queue;
+    struct pool;
+
+    // functions
+    Pool* make(uint);
+    void destroy(Pool*);
+    void submit(Pool*, Task);
+    void wait(Pool*);
+    inline uint num_threads(const Pool*);
+
+
+    //// Implementations
+    struct queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    struct pool {
+        std::vector<std::thread> threads;
+        std::vector<std::unique_ptr<queue>> queues;  // one per worker
+        std::atomic<uint> next_queue;  // for round-robin submission from outside
+
+        // sleeping when there is nothing to run; `queued` only grows under idle_lock
+        std::mutex idle_lock;
+        std::condition_variable idle;
+        std::atomic<size_t> queued;
+        bool stopping;
+
+        // wait() sleeps until every submitted task has finished
+        std::mutex done_lock;
+        std::condition_variable done;
+        std::atomic<size_t> unfinished;
+    };
+
+    // index of the calling thread's queue in the pool it works for, if any
+    static thread_local const Pool* current_pool = nullptr;
+    static thread_local uint current_queue = 0;
+
+    static bool
+    take(Pool* pool, uint self, Task* task) {
+        uint n = (uint) pool->queues.size();
+        {
+            queue* own = pool->queues[self].get();
+            std::lock_guard<std::mutex> guard(own->lock);
+            if (! own->tasks.empty()) {
+                *task = std::move(own->tasks.back());
+                own->tasks.pop_back();
+                return true;
+            }
+        }
+        for (uint i = 1; i < n; ++i) {
+            queue* victim = pool->queues[(self + i) % n].get();
+            std::lock_guard<std::mutex> guard(victim->lock);
+            if (! victim->tasks.empty()) {
+                *task = std::move(victim->tasks.front());
+                victim->tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void
+    run(Pool* pool, uint self) {
+        current_pool = pool;
+        current_queue = self;
+        Task task;
+        for (;;) {
+            if (take(pool, self, &task)) {
+                pool->queued--;
+                task();
+                task = nullptr;
+                if (--pool->unfinished == 0) {
+                    std::lock_guard<std::mutex> guard(pool->done_lock);
+                    pool->done.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(pool->idle_lock);
+            pool->idle.wait(guard, [pool] { return pool->stopping || pool->queued > 0; });
+            if (pool->stopping && pool->queued == 0) return;
+        }
+    }
+
+    // Start `num_threads` workers (at least one).
+    Pool*
+    make(uint num_threads) {
+        if (num_threads == 0) num_threads = 1;
+        Pool* pool = new Pool;
+        assert(pool);
+        pool->next_queue = 0;
+        pool->queued = 0;
+        pool->stopping = false;
+        pool->unfinished = 0;
+        for (uint t = 0; t < num_threads; ++t) {
+            pool->queues.emplace_back(new queue);
+        }
+        for (uint t = 0; t < num_threads; ++t) {
+            pool->threads.emplace_back(run, pool, t);
+        }
+        return pool;
+    }
+
+    // Run every task already submitted, then stop the workers and free the pool.
+    void
+    destroy(Pool* pool) {
+        {
+            std::lock_guard<std::mutex> guard(pool->idle_lock);
+            pool->stopping = true;
+        }
+        pool->idle.notify_all();
+        for (auto& thread : pool->threads) {
+            thread.join();
+        }
+        delete pool;
+    }
+
+    void
+    submit(Pool* pool, Task task) {
+        pool->unfinished++;
+        uint target = (current_pool == pool) ? current_queue
+            : pool->next_queue.fetch_add(1, std::memory_order_relaxed) % (uint) pool->queues.size();
+        // counted before it is visible, so a worker that takes it never sees the count go below zero
+        {
+            std::lock_guard<std::mutex> guard(pool->idle_lock);
+            pool->queued++;
+        }
+        {
+            queue* q = pool->queues[target].get();
+            std::lock_guard<std::mutex> guard(q->lock);
+            q->tasks.push_back(std::move(task));
+        }
+        pool->idle.notify_one();
+    }
+
+    // Block until every task submitted so far (and every task they submit) has finished. Not for use inside a task.
+    void
+    wait(Pool* pool) {
+        assert( current_pool != pool );
+        std::unique_lock<std::mutex> guard(pool->done_lock);
+        pool->done.wait(guard, [pool] { return pool->unfinished == 0; });
+    }
+
+    inline uint
+    num_threads(const Pool* pool) {
+        return (uint) pool->threads.size();
+    }
+
+} // end namespace
+
+
+#endif